@@ -0,0 +1,84 @@
+#pragma once
+/**
+ * BlockSizeTuner.h - audio block size calibration
+ *
+ * Sweeps a list of candidate block sizes, asks a measurement function for the callback
+ * CPU load at each one (as a fraction of the block period) and selects the smallest
+ * block size whose load stays under the target. Smaller blocks mean lower latency but
+ * a larger share of per-callback overhead, so the result is the best latency the
+ * current firmware can afford.
+ *
+ * The tuner knows nothing about the platform: on the Daisy the measurement restarts the
+ * audio engine with the new block size and reads a CPU load meter, on the host it times
+ * a simulated callback.
+ *
+ * Usage:
+ *   tuning::BlockSizeTuner<> tuner(0.7f);
+ *   size_t blockSize = tuner.Run([](size_t n) { return MeasureLoad(n); });
+ */
+
+#include <cstddef>
+
+namespace tuning {
+
+/** Power-of-two sweep covering 1..64 samples per callback. */
+constexpr size_t kDefaultBlockSizes[] = { 1, 2, 4, 8, 16, 32, 64 };
+constexpr size_t kNumDefaultBlockSizes = sizeof(kDefaultBlockSizes) / sizeof(kDefaultBlockSizes[0]);
+
+template <size_t NCandidates = kNumDefaultBlockSizes>
+class BlockSizeTuner
+{
+  public:
+    /** @param target_load  maximum acceptable callback load (0..1 of the block period) */
+    explicit BlockSizeTuner(float target_load = 0.7f)
+    : target_load_(target_load)
+    {
+        for(size_t i = 0; i < NCandidates; ++i)
+            candidates_[i] = kDefaultBlockSizes[i < kNumDefaultBlockSizes ? i : kNumDefaultBlockSizes - 1];
+    }
+
+    BlockSizeTuner(const size_t (&candidates)[NCandidates], float target_load)
+    : target_load_(target_load)
+    {
+        for(size_t i = 0; i < NCandidates; ++i)
+            candidates_[i] = candidates[i];
+    }
+
+    /** Measures every candidate (in ascending order) and returns the selected block size.
+     *  @param measure  callable float(size_t block_size) returning the CPU load at that size
+     */
+    template <typename MeasureFn>
+    size_t Run(MeasureFn&& measure)
+    {
+        selected_ = NCandidates - 1; // nothing fits: fall back to the largest block
+        bool found = false;
+
+        for(size_t i = 0; i < NCandidates; ++i)
+        {
+            loads_[i] = measure(candidates_[i]);
+            if(!found && loads_[i] <= target_load_)
+            {
+                selected_ = i;
+                found     = true;
+            }
+        }
+
+        return candidates_[selected_];
+    }
+
+    size_t NumCandidates() const { return NCandidates; }
+    size_t Candidate(size_t i) const { return (i < NCandidates) ? candidates_[i] : 0; }
+    float  Load(size_t i) const { return (i < NCandidates) ? loads_[i] : 0.f; }
+    float  TargetLoad() const { return target_load_; }
+
+    size_t SelectedBlockSize() const { return candidates_[selected_]; }
+    float  SelectedLoad() const { return loads_[selected_]; }
+
+  private:
+    float  target_load_;
+    size_t candidates_[NCandidates] = {};
+    float  loads_[NCandidates]      = {};
+    size_t selected_                = NCandidates - 1;
+};
+
+} // namespace tuning
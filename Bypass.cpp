@@ -0,0 +1,51 @@
+#include "Bypass.h"
+
+void Bypass::prepare(float sampleRate, float fadeMs)
+{
+    const float fadeSamples = sampleRate * fadeMs * 0.001f;
+    step = (fadeSamples > 1.0f) ? 1.0f / fadeSamples : 1.0f;
+    mix = target;
+}
+
+void Bypass::setEngaged(bool shouldBeEngaged)
+{
+    const float newTarget = shouldBeEngaged ? 1.0f : 0.0f;
+    if (newTarget == target)
+        return;
+
+    // Coming back from a full bypass with a stopped DSP
+    if (shouldBeEngaged && mix == 0.0f && mode == Mode::Reset)
+        resetPending = true;
+
+    target = newTarget;
+}
+
+bool Bypass::consumeResetRequest()
+{
+    const bool pending = resetPending;
+    resetPending = false;
+    return pending;
+}
+
+void Bypass::process(const float* dry, float* wet, size_t numSamples)
+{
+    if (mix == target)
+    {
+        if (mix == 0.0f)
+            for (size_t n = 0; n < numSamples; ++n)
+                wet[n] = dry[n];
+        return; // fully engaged: wet already holds the output
+    }
+
+    // Linear ramp towards the target, clamped at the end of the fade
+    const float delta = (target > mix) ? step : -step;
+    float g = mix;
+    for (size_t n = 0; n < numSamples; ++n)
+    {
+        g += delta;
+        if ((delta > 0.0f && g > target) || (delta < 0.0f && g < target))
+            g = target;
+        wet[n] = dry[n] + g * (wet[n] - dry[n]);
+    }
+    mix = g;
+}
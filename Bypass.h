@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+
+/*
+ * Click-free bypass. The mix between the dry and the processed signal is ramped linearly
+ * over a short fade instead of switching hard, and the whole per-sample decision is made
+ * once per block (fully dry, fully wet or fading).
+ *
+ * While bypassed the DSP can either keep running on the input (KeepWarm, its state is
+ * current when it comes back) or stop entirely (Reset, no DSP cost; the caller resets the
+ * DSP state before the fade-in so it never resumes from stale values).
+ */
+class Bypass
+{
+public:
+    enum class Mode { KeepWarm, Reset };
+
+    void prepare(float sampleRate, float fadeMs = 5.0f);
+
+    void setEngaged(bool shouldBeEngaged);
+    bool isEngaged() const { return target > 0.5f; }
+
+    void setMode(Mode newMode) { mode = newMode; }
+
+    // True when the processed signal has to be rendered for the next block
+    bool wetNeeded() const { return mode == Mode::KeepWarm || mix > 0.0f || target > 0.0f; }
+
+    // Returns true once when the DSP restarts in Reset mode; the caller must reset it then
+    bool consumeResetRequest();
+
+    // Writes the crossfaded result into wet (in place). wet is ignored while fully bypassed.
+    void process(const float* dry, float* wet, size_t numSamples);
+
+private:
+    Mode mode = Mode::Reset;
+    float mix = 0.0f;    // 0 = dry, 1 = processed
+    float target = 0.0f;
+    float step = 1.0f;   // mix change per sample
+    bool resetPending = false;
+};
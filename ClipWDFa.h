@@ -7,6 +7,7 @@
 #pragma once
 
 #include <chowdsp_wdf/chowdsp_wdf.h>
+#include "Denormals.h"
 
 class ClipWDFa
 {
@@ -21,6 +22,30 @@ public:
     void reset()
     {
         C2.reset();
+
+        // The output is read before S3.incident() updates R5, so its last waves act as state
+        // too (and would carry a NaN or Inf through a reset)
+        C2.wdf.a = C2.wdf.b = 0.0f;
+        R5.wdf.a = R5.wdf.b = 0.0f;
+    }
+
+    // Voltage across C2, used to detect when the stage has decayed to silence
+    float getStateVoltage() const
+    {
+        return chowdsp::wdft::voltage<float>(C2);
+    }
+
+    // Clears the capacitor once its state is too small to matter (avoids subnormal tails)
+    void flushDenormals()
+    {
+        if (denormals::flush(getStateVoltage()) == 0.0f)
+            C2.reset();
+    }
+
+    // Time constant of C2 discharging through the series loop, in seconds
+    static constexpr float getTimeConstant()
+    {
+        return C2_value * (Rin_value + RA_value + R5_value);
     }
 
     // takes voltage and returns voltage
@@ -43,11 +68,16 @@ public:
 
 private:
 
-    chowdsp::wdf::Resistor<float> Rin{ 1.0f    };
-    chowdsp::wdf::Resistor<float> RA { 220.0f  };
-    chowdsp::wdf::Resistor<float> R5 { 10000.0f };
+    static constexpr float Rin_value = 1.0f;
+    static constexpr float RA_value = 220.0f;
+    static constexpr float R5_value = 10000.0f;
+    static constexpr float C2_value = 1.0e-6f;
+
+    chowdsp::wdf::Resistor<float> Rin{ Rin_value };
+    chowdsp::wdf::Resistor<float> RA { RA_value  };
+    chowdsp::wdf::Resistor<float> R5 { R5_value  };
 
-    chowdsp::wdf::Capacitor<float> C2{ 1.0e-6f, 48000.0f };
+    chowdsp::wdf::Capacitor<float> C2{ C2_value, 48000.0f };
 
     chowdsp::wdf::WDFSeries<float> S1{ &RA, &R5 };
     chowdsp::wdf::WDFSeries<float> S2{ &C2, &S1 };
@@ -9,6 +9,7 @@
 #pragma once
 
 #include <chowdsp_wdf/chowdsp_wdf.h>
+#include "Denormals.h"
 
 class ClipWDFb
 {
@@ -23,6 +24,30 @@ public:
     void reset()
     {
         C3.reset();
+
+        // The output is read before S1.incident() updates R4, so its last waves act as state
+        // too (and would carry a NaN or Inf through a reset)
+        C3.wdf.a = C3.wdf.b = 0.0f;
+        R4.wdf.a = R4.wdf.b = 0.0f;
+    }
+
+    // Voltage across C3, used to detect when the stage has decayed to silence
+    float getStateVoltage() const
+    {
+        return chowdsp::wdft::voltage<float>(C3);
+    }
+
+    // Clears the capacitor once its state is too small to matter (avoids subnormal tails)
+    void flushDenormals()
+    {
+        if (denormals::flush(getStateVoltage()) == 0.0f)
+            C3.reset();
+    }
+
+    // Time constant of the R4-C3 high-pass, in seconds
+    static constexpr float getTimeConstant()
+    {
+        return C3_value * R4_value;
     }
 
     // Takes voltage and returns current
@@ -43,9 +68,12 @@ public:
     }
 
 private:
-    chowdsp::wdf::Resistor<float> R4{ 4700.0f };
+    static constexpr float R4_value = 4700.0f;
+    static constexpr float C3_value = 47.0e-9f;
+
+    chowdsp::wdf::Resistor<float> R4{ R4_value };
 
-    chowdsp::wdf::Capacitor<float> C3{ 47.0e-9f, 48000.0f };
+    chowdsp::wdf::Capacitor<float> C3{ C3_value, 48000.0f };
 
     chowdsp::wdf::WDFSeries<float> S1{ &C3, &R4 };
 
@@ -2,15 +2,26 @@
  * ClipWDFc is the third and final part of the WDF implementation of a Tube Screamer clipping section as described in
  * "An Improved and Generalized Diode Clipper Model for Wave Digital Filters" by Werner et al.
  * It models the final stage of the clipping circuit, the voltage across the diode pair which clip the signal.
+ * Quality selects the diode pair equation (see DiodePairRoot.h).
 */
 
 #pragma once
 
 #include <chowdsp_wdf/chowdsp_wdf.h>
+#include "Denormals.h"
+#include "DiodePairRoot.h"
 
+template <chowdsp::wdft::DiodeQuality Quality = chowdsp::wdft::DiodeQuality::Best>
 class ClipWDFc
 {
 public:
+    // Fully adapted state of the stage for one drive setting
+    struct Coefficients
+    {
+        float Rs;                                // R6 + drive pot, resistance of the current source
+        typename DiodePairRoot<Quality>::Coefficients diode;
+    };
+
     ClipWDFc() = default;
 
     void prepare(double sampleRate)
@@ -21,14 +32,69 @@ public:
     void reset()
     {
         C4.reset();
+
+        // The output is read before P1.incident() updates C4, so its last waves act as state
+        // too (and would carry a NaN or Inf through a reset)
+        C4.wdf.a = C4.wdf.b = 0.0f;
+    }
+
+    // Voltage across C4, used to detect when the stage has decayed to silence
+    float getStateVoltage() const
+    {
+        return chowdsp::wdft::voltage<float>(C4);
+    }
+
+    // Clears the capacitor once its state is too small to matter (avoids subnormal tails)
+    void flushDenormals()
+    {
+        if (denormals::flush(getStateVoltage()) == 0.0f)
+            C4.reset();
+    }
+
+    // Time constant of C4 against the current source at a given pot resistance, in seconds.
+    // With the diodes off; conducting diodes only shorten it.
+    static constexpr float getTimeConstant(float potR)
+    {
+        return C4_value * (R6 + potR);
     }
 
     void setPotResitanceValue(float newPotR)
     {
-        constexpr float R6 = (float)5e3;
+        dp.unpinCoefficients();
         Is.setResistanceValue(R6 + newPotR);
     }
 
+    // Computes the adapted constants for a drive setting without touching the running stage
+    Coefficients computeCoefficients(float potR) const
+    {
+        Coefficients c;
+        c.Rs = R6 + potR;
+        c.diode = dp.computeCoefficients(1.0f / (1.0f / c.Rs + C4.wdf.G)); // Is || C4
+        return c;
+    }
+
+    // Installs precomputed constants; only divisions run here, no log()
+    void setCoefficients(const Coefficients& c)
+    {
+        dp.setCoefficients(c.diode);
+        Is.setResistanceValue(c.Rs);
+    }
+
+    Coefficients getCoefficients() const
+    {
+        return { Is.wdf.R, dp.getCoefficients() };
+    }
+
+    // Straight-line blend between two sets, used to morph between presets
+    static Coefficients interpolate(const Coefficients& a, const Coefficients& b, float t)
+    {
+        auto lerp = [t](float x, float y) { return x + t * (y - x); };
+        return { lerp(a.Rs, b.Rs),
+                 { lerp(a.diode.R_Is, b.diode.R_Is),
+                   lerp(a.diode.R_Is_overVt, b.diode.R_Is_overVt),
+                   lerp(a.diode.logR_Is_overVt, b.diode.logR_Is_overVt) } };
+    }
+
     void switchDiodePair(float Is, float Vt)
     {
         dp.setDiodeParameters(Is, Vt, 2.0f); // 2 diodes
@@ -48,14 +114,18 @@ public:
 
 private:
 
+    static constexpr float R6 = (float)5e3;
+
     // Current source is the output of ClipWDFb
     chowdsp::wdf::ResistiveCurrentSource<float> Is;
 
-    chowdsp::wdf::Capacitor<float> C4{ 51.0e-11f };  // changed from 51pF for lower freq cutoff
+    static constexpr float C4_value = 51.0e-11f;  // changed from 51pF for lower freq cutoff
+
+    chowdsp::wdf::Capacitor<float> C4{ C4_value };
 
     chowdsp::wdf::WDFParallel<float> P1{ &Is, &C4 };
 
     // 1N914 diode pair at 25C and VR = 20V
-    chowdsp::wdf::DiodePair<float> dp{ &P1, 25e-9f };
+    DiodePairRoot<Quality> dp{ &P1, 25e-9f };
    
 };
\ No newline at end of file
@@ -4,13 +4,26 @@
  *
  * Features:
  *  - Smoothed 0..1 pot reads via libDaisy::AnalogControl
+ *  - Per-pot taper tables (linear, log, reverse-log, S-curve) built once, read with interpolation
+ *  - Per-pot hysteresis, end dead-bands and quantization, with PotChanged(i) change events so
+ *    coefficients are only recomputed when a pot actually moved
  *  - Debounced SPST (toggle) and momentary footswitch handling via libDaisy::Switch
  *  - Edge detection helpers for momentary actions
+ *  - Multi-rate scheduling: pots and switches each run at their own rate, staggered over the
+ *    Update() ticks. With pot_rate_hz at ctrl_hz / NPots every tick reads exactly one pot
+ *    (plus the switches when they are due); faster pot rates read several pots per tick, all
+ *    of them at ctrl_hz. LEDs are only written when their state changes
  *
  * Usage:
- *   - Compute a control update rate: ctrl_hz = hw.AudioSampleRate() / hw.AudioBlockSize();
- *   - Call Controls::Init(...) once, then Controls::Update() once per audio block.
+ *   - Pick a control update rate, e.g. ctrl_hz = 1000 for a 1 kHz poll from the main loop.
+ *   - Call Controls::Init(...) once, then Controls::Update() at ctrl_hz. Keep it out of the
+ *     audio callback: the DSP should only see a parameter snapshot.
+ *   - pot_rate_hz / switch_rate_hz in Init pick how often each class is actually read; a rate
+ *     at or above ctrl_hz reads it on every Update(). For a flat per-tick cost use
+ *     pot_rate_hz = ctrl_hz / NPots (the firmware: 1 kHz ticks, six pots at ~167 Hz each).
  *   - Read pots with Pot(i), toggles with TogglePressed(i), footswitch edges with FootRising(i), etc.
+ *   - For mapped pots call SetPotTaper(i, Taper::Log, lo, hi) once after Init, then read PotMapped(i).
+ *   - Only recompute what depends on pot i when PotChanged(i) is true after an Update().
  *
  * Wiring (typical):
  *   - Pots: ends to 3V3_A and AGND; wiper to Ai (A0..A11).
@@ -29,6 +42,26 @@ namespace controls {
 using namespace daisy;
 using namespace daisy::seed;
 
+/** Pot response curves for SetPotTaper(). */
+enum class Taper
+{
+    Linear,     // y = lo + (hi - lo) * x
+    Log,        // y = lo * (hi / lo)^x, audio taper (needs lo, hi > 0)
+    ReverseLog, // mirror of Log: fast change at the start of the travel
+    SCurve,     // smoothstep: fine control at both ends
+};
+
+/** Points per taper table; interpolation error of the 1k..20k log taper is ~0.03%. */
+constexpr size_t kTaperPoints = 65;
+
+/** Default jitter rejection: ~8 LSB of a 12-bit reading, and 0.5% snap zones at both ends. */
+constexpr float kDefaultPotHysteresis = 0.002f;
+constexpr float kDefaultPotDeadband   = 0.005f;
+
+/** Default scheduler rates: a knob turn has no content above a few tens of Hz. */
+constexpr float kDefaultPotRateHz    = 1000.0f;
+constexpr float kDefaultSwitchRateHz = 500.0f;
+
 template <size_t NPots, size_t NToggles, size_t NFoots, size_t NLeds>
 class Controls
 {
@@ -43,10 +76,12 @@ class Controls
      * @param foot_pins          array of GPIO pins for momentary footswitches
      * @param leds_pins          array of GPIO pins for LEDs
      * @param effect_on          initial state of effect (true=on), default false
-     * @param ctrl_update_hz     rate in Hz that Update() will be called (usually AudioSampleRate/BlockSize)
+     * @param ctrl_update_hz     rate in Hz that Update() will be called (e.g. 1000 from the main loop)
      * @param pot_flip           invert 0..1 reading (hardware orientation), default false
      * @param pot_invert         multiply by -1 (rarely needed), default false
      * @param pot_slew_seconds   smoothing time constant (default 2 ms)
+     * @param pot_rate_hz        rate at which each pot is read (capped at ctrl_update_hz)
+     * @param switch_rate_hz     rate at which the switches are debounced (capped at ctrl_update_hz)
      */
     void Init(DaisySeed& hw,
               const Pin (&pot_pins)[NPots],
@@ -57,11 +92,16 @@ class Controls
               bool       pot_flip         = false,
               bool       pot_invert       = false,
               bool       effect_on        = false,
-              float      pot_slew_seconds = 0.002f)
+              float      pot_slew_seconds = 0.002f,
+              float      pot_rate_hz      = kDefaultPotRateHz,
+              float      switch_rate_hz   = kDefaultSwitchRateHz)
     {
         hw_            = &hw;
         ctrl_update_hz_ = ctrl_update_hz;
         effect_on_     = effect_on;
+        pot_rate_hz_    = pot_rate_hz;
+        switch_rate_hz_ = switch_rate_hz;
+        UpdateSchedule();
 
         // --- ADC + Pots ---
         if (NPots > 0)
@@ -74,8 +114,12 @@ class Controls
 
             for(size_t i = 0; i < NPots; ++i)
             {
-                pots_[i].Init(hw_->adc.GetPtr(i), ctrl_update_hz_, pot_flip, pot_invert, pot_slew_seconds);
+                pots_[i].Init(hw_->adc.GetPtr(i), PotRateHz(), pot_flip, pot_invert, pot_slew_seconds);
                 pot_values_[i] = 0.f;
+                pot_changed_[i] = false;
+                pot_read_[i] = false;
+                SetPotTaper(i, Taper::Linear, 0.f, 1.f);
+                SetPotHysteresis(i, kDefaultPotHysteresis, kDefaultPotDeadband);
             }
         }
 
@@ -107,38 +151,125 @@ class Controls
                         GPIO::Pull::NOPULL,
                         GPIO::Speed::LOW);
                 leds_[i].Write(false); // start OFF
+                led_states_[i] = false;
             }
         }
     }
 
-    /** Call once per audio block (or at ctrl_update_hz). */
+    /** Call at ctrl_update_hz (from the main loop). Only the inputs due on this tick are read. */
     void Update()
     {
         if (NPots > 0)
         {
             for(size_t i = 0; i < NPots; ++i)
-                pot_values_[i] = pots_[i].Process(); // smoothed, normalized 0..1
+            {
+                // Pot i owns one slot of the pot period, so the reads are spread evenly
+                pot_changed_[i] = (pot_tick_ == pot_slots_[i])
+                                  && FilterPot(i, pots_[i].Process()); // smoothed, normalized 0..1
+            }
         }
 
-        if (NToggles > 0)
+        // Switches share one slot, placed between pot slots when there is room
+        switches_updated_ = (switch_tick_ == switch_slot_);
+        if (switches_updated_)
         {
-            for(size_t i = 0; i < NToggles; ++i)
-                toggles_[i].Debounce();
-        }
+            if (NToggles > 0)
+                for(size_t i = 0; i < NToggles; ++i)
+                    toggles_[i].Debounce();
 
-        if (NFoots > 0)
-        {
-            for(size_t i = 0; i < NFoots; ++i)
-                foots_[i].Debounce();
+            if (NFoots > 0)
+                for(size_t i = 0; i < NFoots; ++i)
+                    foots_[i].Debounce();
         }
+
+        if(++pot_tick_ == pot_divider_)
+            pot_tick_ = 0;
+        if(++switch_tick_ == switch_divider_)
+            switch_tick_ = 0;
     }
 
     // ---------- Pots ----------
+    /** Pot i after hysteresis / dead-band / quantization (held while the pot rests). */
     float Pot(size_t i) const
     {
         return (i < NPots) ? pot_values_[i] : 0.f;
     }
 
+    /** True if Pot(i) changed during the last Update(). */
+    bool PotChanged(size_t i) const
+    {
+        return (i < NPots) ? pot_changed_[i] : false;
+    }
+
+    /** Smoothed reading before hysteresis (for display / calibration). */
+    float PotUnfiltered(size_t i) const
+    {
+        return (i < NPots) ? pot_unfiltered_[i] : 0.f;
+    }
+
+    /** Jitter rejection for pot i.
+     *  @param hysteresis  the reported value only follows once the reading leaves a +-window around it
+     *  @param deadband    readings within this distance of 0 or 1 snap to the end
+     *  @param steps       quantize to this many levels (0 = continuous)
+     */
+    void SetPotHysteresis(size_t i, float hysteresis, float deadband = 0.f, size_t steps = 0)
+    {
+        if(i >= NPots)
+            return;
+        pot_hysteresis_[i] = hysteresis;
+        pot_deadband_[i]   = deadband;
+        pot_steps_[i]      = steps;
+    }
+
+    /** Precompute the response of pot i so PotMapped(i) is a table lookup (no std::pow).
+     *  Log and ReverseLog fall back to Linear unless both bounds are positive. */
+    void SetPotTaper(size_t i, Taper taper, float min_v, float max_v)
+    {
+        if(i >= NPots)
+            return;
+
+        const bool positive = (min_v > 0.f && max_v > 0.f);
+        if(!positive && (taper == Taper::Log || taper == Taper::ReverseLog))
+            taper = Taper::Linear;
+
+        for(size_t k = 0; k < kTaperPoints; ++k)
+        {
+            const float x = static_cast<float>(k) / static_cast<float>(kTaperPoints - 1);
+            float       y;
+            switch(taper)
+            {
+                case Taper::Log: y = min_v * std::pow(max_v / min_v, x); break;
+                case Taper::ReverseLog:
+                    y = min_v + max_v - min_v * std::pow(max_v / min_v, 1.f - x);
+                    break;
+                case Taper::SCurve:
+                    y = min_v + (max_v - min_v) * x * x * (3.f - 2.f * x);
+                    break;
+                case Taper::Linear:
+                default: y = min_v + (max_v - min_v) * x; break;
+            }
+            taper_tables_[i][k] = y;
+        }
+    }
+
+    /** Pot i through the table set by SetPotTaper() (linear 0..1 until then). */
+    float PotMapped(size_t i) const
+    {
+        if(i >= NPots)
+            return 0.f;
+
+        float x = pot_values_[i];
+        if(x < 0.f) x = 0.f; else if(x > 1.f) x = 1.f;
+
+        const float  pos  = x * static_cast<float>(kTaperPoints - 1);
+        size_t       k    = static_cast<size_t>(pos);
+        if(k > kTaperPoints - 2)
+            k = kTaperPoints - 2;
+        const float  frac = pos - static_cast<float>(k);
+        const float* t    = taper_tables_[i].data();
+        return t[k] + frac * (t[k + 1] - t[k]);
+    }
+
     /** Map pot i to [min_v, max_v] with a logarithmic (exponential) response.
     Requires min_v > 0 and max_v > 0. Falls back to linear if not valid. */
     float PotMapped(size_t i, float min_v, float max_v) const
@@ -167,6 +298,9 @@ class Controls
         return (i < NPots) ? pots_[i].GetRawValue() : 0;
     }
 
+    // Edges are reported only on the Update() that debounced the switches, so a switch read at
+    // a lower rate than Update() still fires each edge exactly once.
+
     // ---------- SPST Toggles (latching) ----------
     bool TogglePressed(size_t i) const
     {
@@ -174,11 +308,11 @@ class Controls
     }
     bool ToggleRising(size_t i) const
     {
-        return (i < NToggles) ? toggles_[i].RisingEdge() : false;
+        return (i < NToggles && switches_updated_) ? toggles_[i].RisingEdge() : false;
     }
     bool ToggleFalling(size_t i) const
     {
-        return (i < NToggles) ? toggles_[i].FallingEdge() : false;
+        return (i < NToggles && switches_updated_) ? toggles_[i].FallingEdge() : false;
     }
     float ToggleHeldMs(size_t i) const
     {
@@ -192,11 +326,11 @@ class Controls
     }
     bool FootRising(size_t i) const
     {
-        return (i < NFoots) ? foots_[i].RisingEdge() : false;
+        return (i < NFoots && switches_updated_) ? foots_[i].RisingEdge() : false;
     }
     bool FootFalling(size_t i) const
     {
-        return (i < NFoots) ? foots_[i].FallingEdge() : false;
+        return (i < NFoots && switches_updated_) ? foots_[i].FallingEdge() : false;
     }
     float FootHeldMs(size_t i) const
     {
@@ -205,11 +339,14 @@ class Controls
 
     // ------------------- LEDs --------------------
 
-    /** Set LED i ON/OFF. */
+    /** Set LED i ON/OFF. The GPIO is only touched when the state changes. */
     void LedWrite(size_t i, bool on)
     {
-        if(i < NLeds)
+        if(i < NLeds && led_states_[i] != on)
+        {
             leds_[i].Write(on);
+            led_states_[i] = on;
+        }
     }
 
     /** Toggle LED i and return the new state. */
@@ -217,9 +354,8 @@ class Controls
     {
         if(i < NLeds)
         {
-            bool new_state = !leds_[i].Read();
-            leds_[i].Write(new_state);
-            return new_state;
+            LedWrite(i, !led_states_[i]);
+            return led_states_[i];
         }
         return false;
     }
@@ -227,7 +363,7 @@ class Controls
     /** Read current LED state. */
     bool LedState(size_t i) const
     {
-        return (i < NLeds) ? leds_[i].Read() : false;
+        return (i < NLeds) ? led_states_[i] : false;
     }
 
     // --------------- Effect Toggle ----------------
@@ -243,30 +379,124 @@ class Controls
     }
 
 
-    /** If your block size changes at runtime, call this to keep smoothing stable. */
+    /** If your block size changes at runtime, call this to keep smoothing stable.
+     *  The pot and switch rates are kept; only the tick dividers are recomputed. */
     void SetControlUpdateRate(float hz)
     {
         ctrl_update_hz_ = hz;
+        ApplyRates();
+    }
+
+    /** Change how often pots and switches are read (each capped at the Update() rate). */
+    void SetControlRates(float pot_rate_hz, float switch_rate_hz)
+    {
+        pot_rate_hz_    = pot_rate_hz;
+        switch_rate_hz_ = switch_rate_hz;
+        ApplyRates();
+    }
+
+    /** Effective rates after rounding to a whole number of Update() ticks. */
+    float PotRateHz() const { return ctrl_update_hz_ / static_cast<float>(pot_divider_); }
+    float SwitchRateHz() const { return ctrl_update_hz_ / static_cast<float>(switch_divider_); }
+
+  private:
+    static size_t Divider(float tick_hz, float rate_hz)
+    {
+        if(rate_hz <= 0.f || rate_hz >= tick_hz)
+            return 1;
+        return static_cast<size_t>(tick_hz / rate_hz + 0.5f);
+    }
+
+    /** Recomputes the dividers and the slot of every input within its period. */
+    void UpdateSchedule()
+    {
+        pot_divider_    = Divider(ctrl_update_hz_, pot_rate_hz_);
+        switch_divider_ = Divider(ctrl_update_hz_, switch_rate_hz_);
+        pot_tick_       = 0;
+        switch_tick_    = 0;
+
+        for(size_t i = 0; i < NPots; ++i)
+            pot_slots_[i] = (i * pot_divider_) / NPots;
+
+        // Halfway between two pot slots, so a switch read never lands on a pot read if avoidable
+        const size_t pot_stride = (NPots > 0) ? pot_divider_ / NPots : 0;
+        switch_slot_ = (pot_stride > 1) ? (pot_stride / 2) % switch_divider_ : switch_divider_ - 1;
+    }
+
+    void ApplyRates()
+    {
+        UpdateSchedule();
         if (NPots > 0)
             for(size_t i = 0; i < NPots; ++i)
-                pots_[i].SetSampleRate(ctrl_update_hz_);
+                pots_[i].SetSampleRate(PotRateHz());
         if (NToggles > 0)
             for(size_t i = 0; i < NToggles; ++i)
-                toggles_[i].SetUpdateRate(ctrl_update_hz_); // kept for API compat
+                toggles_[i].SetUpdateRate(SwitchRateHz()); // kept for API compat
         if (NFoots > 0)
             for(size_t i = 0; i < NFoots; ++i)
-                foots_[i].SetUpdateRate(ctrl_update_hz_);   // kept for API compat
+                foots_[i].SetUpdateRate(SwitchRateHz());   // kept for API compat
+    }
+
+    /**
+     * Applies dead-band, hysteresis and quantization; returns true if the held value moved.
+     * The first reading of a pot always counts as a change, so a pot resting at its minimum
+     * (where the held value starts) is still reported once after boot.
+     */
+    bool FilterPot(size_t i, float reading)
+    {
+        pot_unfiltered_[i] = reading;
+        const bool first = !pot_read_[i];
+        pot_read_[i]     = true;
+
+        const float deadband = pot_deadband_[i];
+        float       x        = reading;
+        if(x <= deadband) x = 0.f;
+        else if(x >= 1.f - deadband) x = 1.f;
+
+        // Ends are always reachable; elsewhere the reading must leave the hysteresis window
+        const float held = pot_values_[i];
+        const float diff = (x > held) ? x - held : held - x;
+        if(diff <= pot_hysteresis_[i] && x != 0.f && x != 1.f && !first)
+            return false;
+
+        if(pot_steps_[i] > 1)
+        {
+            const float levels = static_cast<float>(pot_steps_[i] - 1);
+            x = static_cast<float>(static_cast<int>(x * levels + 0.5f)) / levels;
+        }
+
+        if(x == held && !first)
+            return false;
+        pot_values_[i] = x;
+        return true;
     }
 
-  private:
     DaisySeed* hw_            = nullptr;
     float      ctrl_update_hz_ = 1000.0f;
     bool       effect_on_     = false;
 
+    // Scheduler
+    float                      pot_rate_hz_      = kDefaultPotRateHz;
+    float                      switch_rate_hz_   = kDefaultSwitchRateHz;
+    size_t                     pot_divider_      = 1;
+    size_t                     switch_divider_   = 1;
+    size_t                     switch_slot_      = 0;
+    std::array<size_t, NPots>  pot_slots_{};
+    size_t                     pot_tick_         = 0; // position within the pot period
+    size_t                     switch_tick_      = 0; // position within the switch period
+    bool                       switches_updated_ = false;
+
     // Pots
     std::array<AdcChannelConfig, NPots> adc_cfg_{};
     std::array<AnalogControl, NPots>    pots_{};
     std::array<float, NPots>            pot_values_{};
+    std::array<float, NPots>            pot_unfiltered_{};
+    std::array<bool, NPots>             pot_changed_{};
+    std::array<bool, NPots>             pot_read_{}; // FilterPot() has seen a reading
+    std::array<float, NPots>            pot_hysteresis_{};
+    std::array<float, NPots>            pot_deadband_{};
+    std::array<size_t, NPots>           pot_steps_{};
+    std::array<std::array<float, kTaperPoints>, NPots> taper_tables_{};
 
     // Switches
     std::array<Switch, NToggles> toggles_{};
@@ -274,6 +504,7 @@ class Controls
 
     // LEDs
     std::array<GPIO, NLeds> leds_{};
+    std::array<bool, NLeds> led_states_{};
 };
 
 } // namespace controls
@@ -0,0 +1,105 @@
+#pragma once
+/**
+ * Denormals.h - subnormal float protection for the DSP chain
+ *
+ * During decay tails the capacitor states drift towards zero and end up as subnormal
+ * floats, which x86 CPUs process at a fraction of the normal speed. Two complementary
+ * tools are provided:
+ *
+ *  - ScopedNoDenormals: sets flush-to-zero (and denormals-are-zero where available) on
+ *    the calling thread and restores the previous mode on destruction. Put one at the
+ *    top of every host render thread / render function.
+ *  - flush(): zeroes values that are too small to matter. The DSP stages use it once per
+ *    block on their states, which covers platforms (or threads) without FTZ.
+ *
+ * On the Daisy, EnableFlushToZero() is called once at boot. On Cortex-M the FPU mode used
+ * inside interrupt handlers comes from FPDSCR, so that register is set as well.
+ */
+
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define TS_DENORMALS_X86 1
+#elif defined(__aarch64__)
+#define TS_DENORMALS_AARCH64 1
+#elif defined(__arm__) && defined(__VFP_FP__) && !defined(__SOFTFP__)
+#define TS_DENORMALS_ARM_VFP 1
+#endif
+
+namespace denormals {
+
+/** States below this magnitude are inaudible (-300 dB) and are set to zero. */
+constexpr float kFlushThreshold = 1.0e-15f;
+
+inline float flush(float x)
+{
+    return (std::fabs(x) < kFlushThreshold) ? 0.0f : x;
+}
+
+/** Reads the FPU control/status word of the calling thread. */
+inline uint32_t GetFpuMode()
+{
+#if defined(TS_DENORMALS_X86)
+    return _mm_getcsr();
+#elif defined(TS_DENORMALS_AARCH64)
+    uint64_t fpcr;
+    asm volatile("mrs %0, fpcr" : "=r"(fpcr));
+    return static_cast<uint32_t>(fpcr);
+#elif defined(TS_DENORMALS_ARM_VFP)
+    uint32_t fpscr;
+    asm volatile("vmrs %0, fpscr" : "=r"(fpscr));
+    return fpscr;
+#else
+    return 0;
+#endif
+}
+
+inline void SetFpuMode(uint32_t mode)
+{
+#if defined(TS_DENORMALS_X86)
+    _mm_setcsr(mode);
+#elif defined(TS_DENORMALS_AARCH64)
+    const uint64_t fpcr = mode;
+    asm volatile("msr fpcr, %0" : : "r"(fpcr));
+#elif defined(TS_DENORMALS_ARM_VFP)
+    asm volatile("vmsr fpscr, %0" : : "r"(mode));
+#else
+    (void)mode;
+#endif
+}
+
+/** FPU mode bits that enable flush-to-zero (and DAZ on x86). */
+constexpr uint32_t kFlushToZeroBits =
+#if defined(TS_DENORMALS_X86)
+    0x8040u; // MXCSR FTZ (bit 15) | DAZ (bit 6)
+#elif defined(TS_DENORMALS_AARCH64) || defined(TS_DENORMALS_ARM_VFP)
+    1u << 24; // FPCR / FPSCR FZ
+#else
+    0u;
+#endif
+
+/** Enables flush-to-zero for the rest of the program on the calling thread (device boot). */
+inline void EnableFlushToZero()
+{
+    SetFpuMode(GetFpuMode() | kFlushToZeroBits);
+#if defined(FPU_FPDSCR_FZ_Msk)
+    FPU->FPDSCR |= FPU_FPDSCR_FZ_Msk; // default FPSCR loaded on exception entry (audio ISR)
+#endif
+}
+
+class ScopedNoDenormals
+{
+  public:
+    ScopedNoDenormals() : previous_(GetFpuMode()) { SetFpuMode(previous_ | kFlushToZeroBits); }
+    ~ScopedNoDenormals() { SetFpuMode(previous_); }
+
+    ScopedNoDenormals(const ScopedNoDenormals&)            = delete;
+    ScopedNoDenormals& operator=(const ScopedNoDenormals&) = delete;
+
+  private:
+    uint32_t previous_;
+};
+
+} // namespace denormals
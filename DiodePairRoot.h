@@ -0,0 +1,117 @@
+/*
+ * DiodePairRoot is the diode pair used as the root of the clipping stage. It computes the same
+ * wave equations as chowdsp::wdf::DiodePair (Werner et al., eqn (18) "Good" and eqn (39) "Best"),
+ * but its adapted constants can be read and written directly. That lets presets and modulation
+ * install precomputed constants instead of paying a log() on every impedance change.
+ *
+ * Once setCoefficients() has been called the constants are pinned: impedance changes coming up
+ * from the tree no longer recompute them, until unpinCoefficients() or setDiodeParameters().
+ *
+ * The quality is a template argument, so the sample path carries no branch for it. Both
+ * equations use the same constants, so presets computed for one are valid for the other.
+*/
+
+#pragma once
+
+#include <chowdsp_wdf/chowdsp_wdf.h>
+
+template <chowdsp::wdft::DiodeQuality Quality = chowdsp::wdft::DiodeQuality::Best>
+class DiodePairRoot final : public chowdsp::wdf::WDF<float>
+{
+public:
+    // Everything the reflection needs that depends on the port resistance
+    struct Coefficients
+    {
+        float R_Is;
+        float R_Is_overVt;
+        float logR_Is_overVt;
+    };
+
+    DiodePairRoot(chowdsp::wdf::WDF<float>* next, float Is, float Vt = 25.85e-3f, float nDiodes = 1.0f)
+        : chowdsp::wdf::WDF<float>("DiodePair"), next(next)
+    {
+        next->connectToNode(this);
+        setDiodeParameters(Is, Vt, nDiodes);
+    }
+
+    void setDiodeParameters(float newIs, float newVt, float nDiodes)
+    {
+        Is = newIs;
+        Vt = nDiodes * newVt;
+        twoVt = 2.0f * Vt;
+        oneOverVt = 1.0f / Vt;
+        pinned = false;
+        calcImpedance();
+    }
+
+    // Constants for a given port resistance (this is where the log() happens)
+    Coefficients computeCoefficients(float portR) const
+    {
+        Coefficients c;
+        c.R_Is = portR * Is;
+        c.R_Is_overVt = c.R_Is * oneOverVt;
+        c.logR_Is_overVt = std::log(c.R_Is_overVt);
+        return c;
+    }
+
+    void setCoefficients(const Coefficients& c)
+    {
+        coeffs = c;
+        pinned = true;
+    }
+
+    void unpinCoefficients() { pinned = false; }
+
+    static constexpr chowdsp::wdft::DiodeQuality quality = Quality;
+
+    const Coefficients& getCoefficients() const { return coeffs; }
+
+    // Root element: nothing upstream to propagate to
+    inline void propagateImpedance() override { calcImpedance(); }
+
+    inline void calcImpedance() override
+    {
+        if (! pinned)
+            coeffs = computeCoefficients(next->wdf.R);
+    }
+
+    inline void incident(float x) noexcept override
+    {
+        wdf.a = x;
+    }
+
+    inline float reflected() noexcept override
+    {
+        if constexpr (Quality == chowdsp::wdft::DiodeQuality::Best)
+            reflectedBest();
+        else
+            reflectedGood();
+        return wdf.b;
+    }
+
+private:
+    inline void reflectedGood() noexcept
+    {
+        // See eqn (18) from reference paper
+        const float lambda = (float) chowdsp::signum::signum(wdf.a);
+        wdf.b = wdf.a + 2.0f * lambda * (coeffs.R_Is - Vt * chowdsp::Omega::omega4(coeffs.logR_Is_overVt + lambda * wdf.a * oneOverVt + coeffs.R_Is_overVt));
+    }
+
+    inline void reflectedBest() noexcept
+    {
+        // See eqn (39) from reference paper
+        const float lambda = (float) chowdsp::signum::signum(wdf.a);
+        const float lambda_a_over_vt = lambda * wdf.a * oneOverVt;
+        wdf.b = wdf.a - twoVt * lambda * (chowdsp::Omega::omega4(coeffs.logR_Is_overVt + lambda_a_over_vt) - chowdsp::Omega::omega4(coeffs.logR_Is_overVt - lambda_a_over_vt));
+    }
+
+    chowdsp::wdf::WDF<float>* next;
+
+    float Is;        // reverse saturation current
+    float Vt;        // thermal voltage (times number of diodes)
+    float twoVt;
+    float oneOverVt;
+
+    Coefficients coeffs {};
+    bool pinned = false;
+};
@@ -1,6 +1,7 @@
 #ifndef FIR_FILTER_H
 #define FIR_FILTER_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <vector>
 
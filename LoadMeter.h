@@ -0,0 +1,185 @@
+#pragma once
+/**
+ * LoadMeter.h - DSP load of the audio callback, as a fraction of the block period
+ *
+ * Features:
+ *  - CycleCounter: the cheapest timestamp each platform has. On the Cortex-M7 the DWT cycle
+ *    counter (one register read, core clock resolution, wraps every ~9 s at 480 MHz, which
+ *    a callback never comes near); on the host clock_gettime(CLOCK_MONOTONIC) in ns.
+ *  - LoadMeter: timestamps the start and end of every callback and keeps the minimum,
+ *    the average (one-pole, like libDaisy's CpuLoadMeter), the maximum, a decaying peak
+ *    (holds spikes long enough for a human or a 10 Hz poll to see them) and a count of
+ *    overruns (blocks that took longer than their period).
+ *
+ * The audio side updates the statistics and publishes them through a TripleBuffer
+ * (ParamChannel.h), so the main loop always reads one consistent set without locking.
+ * Reset() is a request the callback acts on at its next block, so it is safe from the main
+ * loop while audio runs.
+ *
+ * Usage:
+ *   audio:  meter.OnBlockStart(); ... meter.OnBlockEnd(frames);
+ *   main:   const load::LoadStats s = meter.Read();   // s.avg, s.peak, s.overruns ...
+ */
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "ParamChannel.h"
+
+#if defined(__arm__) && defined(__ARM_ARCH_7EM__)
+#define TS_LOAD_DWT 1
+extern "C" uint32_t SystemCoreClock; // CMSIS, core clock in Hz
+#else
+#include <time.h>
+#endif
+
+namespace load {
+
+class CycleCounter
+{
+  public:
+#if defined(TS_LOAD_DWT)
+    using Ticks = uint32_t; // wraps; differences stay correct
+
+    /** Enables the DWT cycle counter (trace enable, unlock, count). */
+    static void Init()
+    {
+        Reg(kDemcr) |= 1u << 24;    // DEMCR.TRCENA
+        Reg(kDwtLar)    = 0xC5ACCE55u; // M7: unlock the DWT registers
+        Reg(kDwtCyccnt) = 0;
+        Reg(kDwtCtrl) |= 1u;        // DWT_CTRL.CYCCNTENA
+    }
+
+    static Ticks Now() { return Reg(kDwtCyccnt); }
+    static float TicksPerSecond() { return static_cast<float>(SystemCoreClock); }
+
+  private:
+    static constexpr uintptr_t kDemcr     = 0xE000EDFCu;
+    static constexpr uintptr_t kDwtCtrl   = 0xE0001000u;
+    static constexpr uintptr_t kDwtCyccnt = 0xE0001004u;
+    static constexpr uintptr_t kDwtLar    = 0xE0001FB0u;
+
+    static volatile uint32_t& Reg(uintptr_t address) { return *reinterpret_cast<volatile uint32_t*>(address); }
+#else
+    using Ticks = uint64_t; // nanoseconds
+
+    static void Init() {}
+
+    static Ticks Now()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<Ticks>(ts.tv_sec) * 1000000000u + static_cast<Ticks>(ts.tv_nsec);
+    }
+
+    static float TicksPerSecond() { return 1.0e9f; }
+#endif
+};
+
+/** Loads are fractions of the block period: 1.0 means the callback used all of it. */
+struct LoadStats
+{
+    float    min      = 0.0f;
+    float    avg      = 0.0f;
+    float    max      = 0.0f;
+    float    peak     = 0.0f; // decaying peak
+    float    last     = 0.0f; // most recent block
+    uint32_t blocks   = 0;    // since the last reset
+    uint32_t overruns = 0;    // blocks over their period
+};
+
+class LoadMeter
+{
+  public:
+    /**
+     * Call with audio stopped.
+     * @param avgCutoffHz  smoothing of the average
+     * @param peakReleaseMs  time constant of the decaying peak
+     */
+    void Init(float sampleRate, size_t blockSize, float avgCutoffHz = 1.0f, float peakReleaseMs = 500.0f)
+    {
+        CycleCounter::Init();
+        sampleRate_    = sampleRate;
+        avgCutoffHz_   = avgCutoffHz;
+        peakReleaseMs_ = peakReleaseMs;
+        SetBlockSize(blockSize);
+        stats_ = {};
+        resetRequest_.store(false, std::memory_order_relaxed);
+        published_.Write(stats_);
+    }
+
+    // ---------- Audio side ----------
+    inline void OnBlockStart() { start_ = CycleCounter::Now(); }
+
+    /**
+     * blockSize is the number of frames the callback was actually given: if the audio was
+     * restarted at another size behind the meter's back, the budget follows it.
+     */
+    inline void OnBlockEnd(size_t blockSize)
+    {
+        if(blockSize != blockSize_)
+            SetBlockSize(blockSize);
+        OnBlockEnd();
+    }
+
+    inline void OnBlockEnd()
+    {
+        const float load = static_cast<float>(CycleCounter::Now() - start_) * invBudget_;
+
+        if(resetRequest_.exchange(false, std::memory_order_acquire))
+            stats_ = {};
+
+        if(stats_.blocks == 0)
+            stats_.min = stats_.avg = stats_.max = load;
+        stats_.min = load < stats_.min ? load : stats_.min;
+        stats_.max = load > stats_.max ? load : stats_.max;
+        stats_.avg += avgCoeff_ * (load - stats_.avg);
+        stats_.peak = load > stats_.peak * peakDecay_ ? load : stats_.peak * peakDecay_;
+        stats_.last = load;
+        stats_.overruns += load > 1.0f ? 1 : 0;
+        ++stats_.blocks;
+
+        published_.Write(stats_);
+    }
+
+    /** Load of the block that just ended (audio side, after OnBlockEnd()). */
+    float LastLoad() const { return stats_.last; }
+
+    // ---------- Main loop side ----------
+    /** The latest statistics published by the callback. */
+    LoadStats Read()
+    {
+        published_.Update();
+        return published_.Read();
+    }
+
+    /** Restarts min / avg / max / peak / counts at the next block. */
+    void Reset() { resetRequest_.store(true, std::memory_order_release); }
+
+  private:
+    void SetBlockSize(size_t blockSize)
+    {
+        const float blockSeconds = static_cast<float>(blockSize) / sampleRate_;
+        blockSize_ = blockSize;
+        invBudget_ = 1.0f / (blockSeconds * CycleCounter::TicksPerSecond());
+        avgCoeff_  = avgCutoffHz_ * blockSeconds;
+        peakDecay_ = std::exp(-blockSeconds / (0.001f * peakReleaseMs_));
+    }
+
+    CycleCounter::Ticks start_         = 0;
+    float               sampleRate_    = 48000.0f;
+    float               avgCutoffHz_   = 1.0f;
+    float               peakReleaseMs_ = 500.0f;
+    size_t              blockSize_     = 0;
+    float               invBudget_     = 0.0f; // 1 / ticks per block period
+    float               avgCoeff_      = 0.0f;
+    float               peakDecay_     = 0.0f; // per block
+    LoadStats           stats_;                // audio side only
+
+    params::TripleBuffer<LoadStats> published_;
+    std::atomic<bool>               resetRequest_ { false };
+};
+
+} // namespace load
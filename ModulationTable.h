@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+
+/*
+ * Table of precomputed values over a 0..1 modulation position, read with linear interpolation.
+ *
+ * build() evaluates the expensive function (impedance adaptation, log(), pow()) once per
+ * point outside the audio thread; lookups in the sample loop are a clamp, one multiply and
+ * one interpolation between neighbouring entries. Lerp blends two entries, so structured
+ * coefficient sets (e.g. ClipWDFc::Coefficients) can be tabulated as well as plain floats.
+ */
+inline float lerpFloat(const float& a, const float& b, float t)
+{
+    return a + t * (b - a);
+}
+
+template <typename T, size_t N, T (*Lerp)(const T&, const T&, float)>
+class ModulationTable
+{
+    static_assert(N >= 2, "ModulationTable needs at least two points");
+
+public:
+    // compute(position) is called for N evenly spaced positions from 0 to 1
+    template <typename Fn>
+    void build(Fn&& compute)
+    {
+        for (size_t k = 0; k < N; ++k)
+            table[k] = compute(static_cast<float>(k) / static_cast<float>(N - 1));
+    }
+
+    inline T operator()(float position) const noexcept
+    {
+        if (position < 0.0f)
+            position = 0.0f;
+        else if (position > 1.0f)
+            position = 1.0f;
+
+        const float pos = position * static_cast<float>(N - 1);
+        size_t k = static_cast<size_t>(pos);
+        if (k > N - 2)
+            k = N - 2;
+        return Lerp(table[k], table[k + 1], pos - static_cast<float>(k));
+    }
+
+private:
+    T table[N] {};
+};
@@ -1,5 +1,7 @@
 #include "Oversampler2x.h"
 
+#include <cmath>
+
 void Oversampler2x::prepare()
 {
     y1 = y2 = 0.0f;
@@ -17,3 +19,21 @@ float Oversampler2x::downsample(float y0)
     y1 = y0;
     return result;
 }
+
+void Oversampler2x::flushDenormals()
+{
+    y1 = denormals::flush(y1);
+    y2 = denormals::flush(y2);
+}
+
+float Oversampler2x::getStateMagnitude() const
+{
+    const float a1 = y1 < 0.0f ? -y1 : y1;
+    const float a2 = y2 < 0.0f ? -y2 : y2;
+    return a1 > a2 ? a1 : a2;
+}
+
+bool Oversampler2x::isFinite() const
+{
+    return std::isfinite(y1) && std::isfinite(y2);
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Denormals.h"
+
 class Oversampler2x
 {
 public:
@@ -7,6 +9,11 @@ public:
     void upsample(float x, float& x1, float& x2);
     float downsample(float y0);
 
+    // Largest magnitude held in the decimator history
+    float getStateMagnitude() const;
+    bool isFinite() const;
+    void flushDenormals();
+
 private:
     float y1 = 0.0f;
     float y2 = 0.0f;
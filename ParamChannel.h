@@ -0,0 +1,135 @@
+#pragma once
+/**
+ * ParamChannel.h - wait-free parameter hand-off from a control context to the DSP
+ *
+ * Features:
+ *  - TripleBuffer<T>: latest-value snapshot. The producer never waits for the consumer and
+ *    the consumer always reads a complete, consistent snapshot; intermediate values the
+ *    consumer did not get to are simply skipped.
+ *  - SpscQueue<T, N>: bounded FIFO for discrete events (footswitch presses, resets, ...)
+ *    that must neither be merged nor lost.
+ *  - ParamChannel<Snapshot, Event, N>: both of the above, with the audio side consuming
+ *    once per block.
+ *
+ * Exactly one producer (main loop / UI thread) and one consumer (audio interrupt / render
+ * thread). No heap, no locks: only lock-free std::atomic on a byte or a word, which the
+ * Cortex-M7 implements with LDREX/STREX, so both ends are safe to call from an ISR.
+ *
+ * Usage:
+ *   producer:  channel.Publish(snapshot);  channel.Post(event);
+ *   consumer:  if(channel.Consume()) Apply(channel.Snapshot());
+ *              while(channel.PopEvent(ev)) Handle(ev);
+ */
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace params {
+
+template <typename T>
+class TripleBuffer
+{
+  public:
+    TripleBuffer() = default;
+    explicit TripleBuffer(const T& initial) { buffers_.fill(initial); }
+
+    /** Producer: publish a new value. Never blocks. */
+    void Write(const T& value)
+    {
+        buffers_[back_] = value;
+        back_ = middle_.exchange(static_cast<uint8_t>(back_ | kDirty), std::memory_order_acq_rel) & kIndexMask;
+    }
+
+    /** Consumer: pick up the newest value if there is one. Returns true if Read() changed. */
+    bool Update()
+    {
+        if((middle_.load(std::memory_order_relaxed) & kDirty) == 0)
+            return false;
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & kIndexMask;
+        return true;
+    }
+
+    /** Consumer: the snapshot picked up by the last Update(). */
+    const T& Read() const { return buffers_[front_]; }
+
+  private:
+    static constexpr uint8_t kDirty     = 0x4;
+    static constexpr uint8_t kIndexMask = 0x3;
+
+    static_assert(std::atomic<uint8_t>::is_always_lock_free, "TripleBuffer needs a lock-free byte atomic");
+
+    std::array<T, 3>     buffers_{};
+    uint8_t              back_   = 0; // producer only
+    std::atomic<uint8_t> middle_ { 1 };
+    uint8_t              front_  = 2; // consumer only
+};
+
+template <typename T, size_t N>
+class SpscQueue
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "SpscQueue needs a lock-free word atomic");
+
+  public:
+    /** Producer: returns false (and drops the item) when the queue is full. */
+    bool Push(const T& item)
+    {
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        if(head - tail_.load(std::memory_order_acquire) == N)
+            return false;
+        items_[head & (N - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Consumer: returns false when there is nothing to pop. */
+    bool Pop(T& item)
+    {
+        const uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if(head_.load(std::memory_order_acquire) == tail)
+            return false;
+        item = items_[tail & (N - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Empty() const
+    {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+  private:
+    std::array<T, N>      items_{};
+    std::atomic<uint32_t> head_ { 0 }; // written by the producer
+    std::atomic<uint32_t> tail_ { 0 }; // written by the consumer
+};
+
+template <typename SnapshotT, typename EventT, size_t NEvents = 16>
+class ParamChannel
+{
+  public:
+    ParamChannel() = default;
+    explicit ParamChannel(const SnapshotT& initial) : snapshot_(initial) {}
+
+    // ---------- Producer (control context) ----------
+    void Publish(const SnapshotT& snapshot) { snapshot_.Write(snapshot); }
+
+    /** Returns false if the consumer has fallen NEvents behind; the event is dropped. */
+    bool Post(const EventT& event) { return events_.Push(event); }
+
+    // ---------- Consumer (audio context), once per block ----------
+    /** Returns true if a newer snapshot was picked up. */
+    bool Consume() { return snapshot_.Update(); }
+
+    const SnapshotT& Snapshot() const { return snapshot_.Read(); }
+
+    bool PopEvent(EventT& event) { return events_.Pop(event); }
+
+  private:
+    TripleBuffer<SnapshotT>     snapshot_;
+    SpscQueue<EventT, NEvents>  events_;
+};
+
+} // namespace params
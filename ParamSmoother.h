@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stddef.h>
+
+/*
+ * Parameter smoothers used to avoid zipper noise on control changes.
+ *
+ * LinearSmoother reaches the target in a fixed time and can jump ahead by a whole segment,
+ * which is what the sub-block coefficient updates in TubeScreamer use: the expensive
+ * recompute happens once per segment with the interpolated value. ExpSmoother is a one-pole
+ * glide for cheap per-sample gains, where a softer approach sounds more natural.
+ */
+class LinearSmoother
+{
+public:
+    void prepare(float sampleRate, float rampMs)
+    {
+        const float samples = sampleRate * rampMs * 0.001f;
+        rampSamples = (samples > 1.0f) ? static_cast<size_t>(samples) : 1;
+        setCurrentAndTarget(target);
+    }
+
+    void setTarget(float newTarget)
+    {
+        if (newTarget == target)
+            return;
+        target = newTarget;
+        remaining = rampSamples;
+        step = (target - current) / static_cast<float>(rampSamples);
+    }
+
+    void setCurrentAndTarget(float value)
+    {
+        current = target = value;
+        remaining = 0;
+        step = 0.0f;
+    }
+
+    inline float getNext()
+    {
+        if (remaining == 0)
+            return current;
+        current = (--remaining == 0) ? target : current + step;
+        return current;
+    }
+
+    // Advances numSamples at once and returns the value reached
+    float skip(size_t numSamples)
+    {
+        if (numSamples >= remaining)
+        {
+            current = target;
+            remaining = 0;
+        }
+        else
+        {
+            current += step * static_cast<float>(numSamples);
+            remaining -= numSamples;
+        }
+        return current;
+    }
+
+    bool isSmoothing() const { return remaining > 0; }
+    float getCurrent() const { return current; }
+    float getTarget() const { return target; }
+
+private:
+    float current = 0.0f;
+    float target = 0.0f;
+    float step = 0.0f;
+    size_t remaining = 0;
+    size_t rampSamples = 1;
+};
+
+class ExpSmoother
+{
+public:
+    // rampMs is the time constant (63% of the way to the target)
+    void prepare(float sampleRate, float rampMs)
+    {
+        const float samples = sampleRate * rampMs * 0.001f;
+        coeff = (samples > 1.0f) ? 1.0f / samples : 1.0f;
+        current = target;
+    }
+
+    void setTarget(float newTarget) { target = newTarget; }
+    void setCurrentAndTarget(float value) { current = target = value; }
+
+    inline float getNext()
+    {
+        current += coeff * (target - current);
+        const float diff = target - current;
+        if (diff < kSnap && diff > -kSnap)
+            current = target;
+        return current;
+    }
+
+    bool isSmoothing() const { return current != target; }
+    float getCurrent() const { return current; }
+    float getTarget() const { return target; }
+
+private:
+    static constexpr float kSnap = 1.0e-6f;
+
+    float current = 0.0f;
+    float target = 0.0f;
+    float coeff = 1.0f;
+};
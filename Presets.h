@@ -0,0 +1,168 @@
+#pragma once
+/**
+ * Presets.h - preset bank with precomputed coefficient sets
+ *
+ * Features:
+ *  - Each preset keeps its user-facing settings *and* the fully adapted chain coefficients
+ *    (port resistances, diode constants, tone values) computed once when it is stored, so a
+ *    recall is just TubeScreamer::recallCoefficients(preset.coeffs) on the audio side.
+ *  - Save/Load through the PresetStorage interface: QSPI flash on the Daisy
+ *    (QspiPresetStorage.h), RamPresetStorage for host tools and tests.
+ *  - Coefficients are only valid at the sample rate they were computed for; Load() recomputes
+ *    them when the stored rate differs.
+ *
+ * Image layout (native endianness): Header, NPresets x Preset, uint32 FNV-1a checksum.
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "TubeScreamer.h"
+
+namespace presets {
+
+/** Settings as the player sees them. */
+struct PresetParams
+{
+    float drive;    // drive pot resistance in ohms
+    float toneR;    // tone resistor in ohms
+    float toneC;    // tone capacitor in farads
+    float preGain;
+    float postGain;
+};
+
+struct Preset
+{
+    PresetParams               params;
+    TubeScreamer::Coefficients coeffs;
+};
+
+/** Byte-addressed non-volatile storage holding one preset image. */
+class PresetStorage
+{
+  public:
+    virtual ~PresetStorage() = default;
+
+    virtual size_t Capacity() const = 0;
+    virtual bool   Read(void* data, size_t size) = 0;
+    /** Replaces the whole image (erase + program on flash). */
+    virtual bool   Write(const void* data, size_t size) = 0;
+};
+
+/** RAM-backed storage for host tools and tests. */
+template <size_t NBytes>
+class RamPresetStorage : public PresetStorage
+{
+  public:
+    size_t Capacity() const override { return NBytes; }
+
+    bool Read(void* data, size_t size) override
+    {
+        if(size > NBytes)
+            return false;
+        std::memcpy(data, bytes_.data(), size);
+        return true;
+    }
+
+    bool Write(const void* data, size_t size) override
+    {
+        if(size > NBytes)
+            return false;
+        std::memcpy(bytes_.data(), data, size);
+        ++writes_;
+        return true;
+    }
+
+    size_t WriteCount() const { return writes_; }
+
+  private:
+    std::array<uint8_t, NBytes> bytes_{};
+    size_t                      writes_ = 0;
+};
+
+template <size_t NPresets>
+class PresetBank
+{
+  public:
+    static constexpr uint32_t kMagic   = 0x31505354; // "TSP1"
+    static constexpr uint32_t kVersion = 1;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t count;
+        float    sample_rate;
+    };
+
+    struct Image
+    {
+        Header                         header;
+        std::array<Preset, NPresets>   presets;
+        uint32_t                       checksum;
+    };
+
+    static constexpr size_t kImageSize = sizeof(Image);
+
+    /** Stores params in slot and precomputes its coefficients (main loop, not the audio ISR). */
+    void Store(size_t slot, const PresetParams& params, const TubeScreamer& ts, float sample_rate)
+    {
+        if(slot >= NPresets)
+            return;
+        image_.presets[slot].params = params;
+        image_.presets[slot].coeffs = ts.computeCoefficients(params.drive, params.toneR, params.toneC);
+        image_.header.sample_rate   = sample_rate;
+    }
+
+    const Preset* Get(size_t slot) const
+    {
+        return (slot < NPresets) ? &image_.presets[slot] : nullptr;
+    }
+
+    size_t Size() const { return NPresets; }
+
+    bool Save(PresetStorage& storage)
+    {
+        image_.header.magic   = kMagic;
+        image_.header.version = kVersion;
+        image_.header.count   = NPresets;
+        image_.checksum       = Checksum(image_);
+        return storage.Capacity() >= kImageSize && storage.Write(&image_, kImageSize);
+    }
+
+    /** Returns false (bank unchanged) if the storage holds no valid image for this bank size. */
+    bool Load(PresetStorage& storage, const TubeScreamer& ts, float sample_rate)
+    {
+        if(storage.Capacity() < kImageSize)
+            return false;
+
+        Image loaded;
+        if(!storage.Read(&loaded, kImageSize))
+            return false;
+        if(loaded.header.magic != kMagic || loaded.header.version != kVersion
+           || loaded.header.count != NPresets || loaded.checksum != Checksum(loaded))
+            return false;
+
+        image_ = loaded;
+        if(image_.header.sample_rate != sample_rate)
+            for(size_t i = 0; i < NPresets; ++i)
+                Store(i, image_.presets[i].params, ts, sample_rate);
+        return true;
+    }
+
+  private:
+    static uint32_t Checksum(const Image& image)
+    {
+        // FNV-1a over everything but the checksum itself
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&image);
+        uint32_t       hash  = 2166136261u;
+        for(size_t i = 0; i < offsetof(Image, checksum); ++i)
+            hash = (hash ^ bytes[i]) * 16777619u;
+        return hash;
+    }
+
+    Image image_{};
+};
+
+} // namespace presets
@@ -0,0 +1,54 @@
+#pragma once
+/**
+ * QspiPresetStorage.h - PresetStorage on the Daisy Seed's external QSPI flash
+ *
+ * The image lives in its own 4 kB-aligned region at the end of the 8 MB chip, away from
+ * anything a QSPI bootloader app would use. Reads go through the memory-mapped QSPI window.
+ * Write() erases and programs the region and stalls the main loop while doing so
+ * (tens of ms), so only call it on an explicit save.
+ */
+
+#include <cstring>
+#include "daisy_seed.h"
+#include "Presets.h"
+
+namespace presets {
+
+class QspiPresetStorage : public PresetStorage
+{
+  public:
+    static constexpr uint32_t kDefaultOffset = 0x7F0000; // last 64 kB of the QSPI flash
+    static constexpr size_t   kRegionSize    = 0x10000;
+
+    explicit QspiPresetStorage(daisy::QSPIHandle& qspi, uint32_t offset = kDefaultOffset)
+    : qspi_(qspi), offset_(offset)
+    {
+    }
+
+    size_t Capacity() const override { return kRegionSize; }
+
+    bool Read(void* data, size_t size) override
+    {
+        if(size > kRegionSize)
+            return false;
+        std::memcpy(data, qspi_.GetData(offset_), size);
+        return true;
+    }
+
+    bool Write(const void* data, size_t size) override
+    {
+        if(size > kRegionSize)
+            return false;
+        if(qspi_.Erase(offset_, offset_ + static_cast<uint32_t>(size)) != daisy::QSPIHandle::Result::OK)
+            return false;
+        return qspi_.Write(offset_, static_cast<uint32_t>(size),
+                           const_cast<uint8_t*>(static_cast<const uint8_t*>(data)))
+               == daisy::QSPIHandle::Result::OK;
+    }
+
+  private:
+    daisy::QSPIHandle& qspi_;
+    uint32_t           offset_;
+};
+
+} // namespace presets
@@ -14,6 +14,21 @@ void RCFilter::prepare(float sampleRate)
     series.propagateImpedance();
 }
 
+void RCFilter::reset()
+{
+    C.reset();
+
+    // processSample() sends the incident wave before pulling the reflected one, so the
+    // capacitor's last waves act as state too
+    C.wdf.a = C.wdf.b = 0.0f;
+}
+
+void RCFilter::flushDenormals()
+{
+    if (denormals::flush(getStateVoltage()) == 0.0f)
+        reset();
+}
+
 float RCFilter::processSample(float input)
 {
     series.incident(input);
@@ -30,8 +45,11 @@ void RCFilter::setResistor(float newR)
 
 void RCFilter::setCapacitor(float newC)
 {
+    if (newC == C_value)
+        return;
+
+    // The capacitor already runs at fs; prepare() would also clear its state and click
     C_value = newC;
     C.setCapacitanceValue(C_value);
-    C.prepare(fs);
     series.propagateImpedance();
 }
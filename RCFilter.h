@@ -1,6 +1,7 @@
 #pragma once
 
 #include <chowdsp_wdf/chowdsp_wdf.h>
+#include "Denormals.h"
 
 class RCFilter
 {
@@ -8,11 +9,18 @@ class RCFilter
         RCFilter(float R_val, float C_val);
 
         void prepare(float sampleRate);
+        void reset();
         float processSample(float input);
 
         void setResistor(float newR);
         void setCapacitor(float newC);
 
+        float getResistor() const { return R_value; }
+        float getCapacitor() const { return C_value; }
+        float getStateVoltage() const { return C.voltage(); }
+        float getTimeConstant() const { return R_value * C_value; }
+        void flushDenormals();
+
     private:
         float R_value;
         float C_value;
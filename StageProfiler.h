@@ -0,0 +1,201 @@
+#pragma once
+/**
+ * StageProfiler.h - compile-time switchable per-stage timing of TubeScreamer's sample path
+ *
+ * Build with TS_PROFILE_STAGES=1 (firmware: make PROFILE_STAGES=1; host: bench_profile) and
+ * every stage of TubeScreamer::processOversampled() is timed with the cheapest cycle counter
+ * of the platform, each measurement going into a fixed-size histogram for that stage:
+ *
+ *   Upsample   Oversampler2x::upsample()
+ *   ClipA      ClipWDFa::processSample()
+ *   ClipB      ClipWDFb::processSample()
+ *   ClipC      ClipWDFc::processSample() (the diode pair)
+ *   Tone       RCFilter::processSample()
+ *   Downsample Oversampler2x::downsample()
+ *
+ * With TS_PROFILE_STAGES=0 (the default) TS_PROFILE(stage, expr) is just (expr): no counter
+ * read, no histogram access, the same code as before the hooks were added.
+ *
+ * It is a build flag like the other TS_* options rather than a template parameter: a
+ * profiling policy next to the diode quality of TubeScreamerT / ClippingStageT would double
+ * every instantiation in libtscore for a tool, while a flag keeps the hooks out of every build
+ * that does not ask for them (the host builds one profiled copy of the sources for
+ * bench_profile).
+ *
+ * Ticks are DWT core cycles on the Seed, TSC ticks on x86 (rdtsc: ~20 cycles per read, not
+ * serializing, fine for statistics over many samples) and ns elsewhere (clock_gettime). Every
+ * sample includes the cost of one counter read; ScopeOverhead() measures it.
+ *
+ * The histograms are global and written by the audio thread without synchronization: read
+ * them from the main loop as an approximate snapshot (a copy taken mid-callback may miss the
+ * samples of that callback), and profile one audio thread at a time.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "LoadMeter.h"
+
+#if !defined(TS_LOAD_DWT) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define TS_PROFILE_RDTSC 1
+#endif
+
+#ifndef TS_PROFILE_STAGES
+#define TS_PROFILE_STAGES 0
+#endif
+
+namespace profile {
+
+enum class Stage : uint8_t
+{
+    Upsample,
+    ClipA,
+    ClipB,
+    ClipC,
+    Tone,
+    Downsample,
+};
+
+constexpr size_t kNumStages = 6;
+
+inline const char* StageName(Stage s)
+{
+    static const char* const names[kNumStages] = { "upsample", "clipA", "clipB", "clipC", "tone", "downsample" };
+    return names[static_cast<size_t>(s)];
+}
+
+struct Clock
+{
+    using Ticks = uint32_t; // wraps; differences stay correct
+
+#if defined(TS_PROFILE_RDTSC)
+    static Ticks Now() { return static_cast<Ticks>(__rdtsc()); }
+    static const char* Unit() { return "TSC ticks"; }
+#elif defined(TS_LOAD_DWT)
+    static Ticks Now() { return load::CycleCounter::Now(); }
+    static const char* Unit() { return "cycles"; }
+#else
+    static Ticks Now() { return static_cast<Ticks>(load::CycleCounter::Now()); }
+    static const char* Unit() { return "ns"; }
+#endif
+};
+
+/**
+ * Log-linear histogram: 4 bins per octave (relative width <= 25 %), from 0 to 2^32 ticks in
+ * 128 bins, so the same layout covers 100-cycle stages on the Seed and ns timings on a host.
+ */
+class Histogram
+{
+  public:
+    static constexpr size_t kBins = 128;
+
+    void Add(uint32_t ticks)
+    {
+        ++bins_[BinOf(ticks)];
+        ++count_;
+        sum_ += ticks;
+        min_ = ticks < min_ ? ticks : min_;
+        max_ = ticks > max_ ? ticks : max_;
+    }
+
+    void Clear() { *this = Histogram(); }
+
+    uint32_t Count() const { return count_; }
+    uint64_t Sum() const { return sum_; }
+    uint32_t Min() const { return count_ > 0 ? min_ : 0; }
+    uint32_t Max() const { return max_; }
+    double   Mean() const { return count_ > 0 ? static_cast<double>(sum_) / count_ : 0.0; }
+    uint32_t Bin(size_t i) const { return bins_[i]; }
+
+    /** Lower edge of the bin holding the p-quantile (0..1). */
+    uint32_t Percentile(double p) const
+    {
+        const double rank = p * static_cast<double>(count_);
+        uint64_t     seen = 0;
+        for(size_t i = 0; i < kBins; ++i)
+        {
+            seen += bins_[i];
+            if(bins_[i] > 0 && static_cast<double>(seen) >= rank)
+                return BinLow(i);
+        }
+        return max_;
+    }
+
+    static size_t BinOf(uint32_t ticks)
+    {
+        if(ticks < 4)
+            return ticks;
+        const int msb = 31 - __builtin_clz(ticks);
+        return 4 * static_cast<size_t>(msb - 1) + ((ticks >> (msb - 2)) & 3u);
+    }
+
+    static uint32_t BinLow(size_t bin)
+    {
+        if(bin < 4)
+            return static_cast<uint32_t>(bin);
+        const size_t msb = bin / 4 + 1;
+        return static_cast<uint32_t>(4 + bin % 4) << (msb - 2);
+    }
+
+  private:
+    uint32_t bins_[kBins] = {};
+    uint32_t count_       = 0;
+    uint64_t sum_         = 0;
+    uint32_t min_         = UINT32_MAX;
+    uint32_t max_         = 0;
+};
+
+inline Histogram histograms[kNumStages];
+
+inline Histogram& Get(Stage s) { return histograms[static_cast<size_t>(s)]; }
+
+inline void ClearAll()
+{
+    for(Histogram& h : histograms)
+        h.Clear();
+}
+
+/** Times its own lifetime into the stage's histogram. */
+class Scope
+{
+  public:
+    explicit Scope(Stage s) : stage_(s), start_(Clock::Now()) {}
+    ~Scope() { Get(stage_).Add(Clock::Now() - start_); }
+
+    Scope(const Scope&)            = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    Stage        stage_;
+    Clock::Ticks start_;
+};
+
+/** Evaluates f() inside a Scope and returns its result (also for void). */
+template <typename F>
+inline auto Measure(Stage s, F&& f)
+{
+    Scope scope(s);
+    return f();
+}
+
+/** Smallest time an empty scope records: the floor under every stage's numbers. */
+inline uint32_t ScopeOverhead(size_t tries = 1000)
+{
+    uint32_t best = UINT32_MAX;
+    for(size_t i = 0; i < tries; ++i)
+    {
+        const Clock::Ticks t0 = Clock::Now();
+        const Clock::Ticks t1 = Clock::Now();
+        best                  = (t1 - t0) < best ? (t1 - t0) : best;
+    }
+    return best;
+}
+
+} // namespace profile
+
+#if TS_PROFILE_STAGES
+#define TS_PROFILE(stage, ...) profile::Measure(profile::Stage::stage, [&]() { return __VA_ARGS__; })
+#else
+#define TS_PROFILE(stage, ...) (__VA_ARGS__)
+#endif
@@ -1,33 +1,82 @@
 #include "TSClipping.h"
 
-ClippingStage::ClippingStage()
+#include <cmath>
+
+#include "StageProfiler.h"
+
+template <chowdsp::wdft::DiodeQuality Quality>
+ClippingStageT<Quality>::ClippingStageT()
 {
 }
 
-void ClippingStage::setDrive(float potValue)
+template <chowdsp::wdft::DiodeQuality Quality>
+void ClippingStageT<Quality>::setDrive(float potValue)
 {
     clipWDFc.setPotResitanceValue(potValue); // Set the pot resistance value based on drive
 }
  
-void ClippingStage::reset()
+template <chowdsp::wdft::DiodeQuality Quality>
+void ClippingStageT<Quality>::reset()
 {
     clipWDFa.reset();
     clipWDFb.reset();
     clipWDFc.reset();
 }
 
-void ClippingStage::prepare(float sampleRate)
+template <chowdsp::wdft::DiodeQuality Quality>
+void ClippingStageT<Quality>::prepare(float sampleRate)
 {
     clipWDFa.prepare(sampleRate);
     clipWDFb.prepare(sampleRate);
     clipWDFc.prepare(sampleRate);
 }
 
-float ClippingStage::processSample(float x, float potValue) noexcept
+template <chowdsp::wdft::DiodeQuality Quality>
+void ClippingStageT<Quality>::flushDenormals()
+{
+    clipWDFa.flushDenormals();
+    clipWDFb.flushDenormals();
+    clipWDFc.flushDenormals();
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+float ClippingStageT<Quality>::getStateMagnitude() const
+{
+    const float a = std::fabs(clipWDFa.getStateVoltage());
+    const float b = std::fabs(clipWDFb.getStateVoltage());
+    const float c = std::fabs(clipWDFc.getStateVoltage());
+    return std::fmax(a, std::fmax(b, c));
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+bool ClippingStageT<Quality>::isFinite() const
+{
+    return std::isfinite(clipWDFa.getStateVoltage()) && std::isfinite(clipWDFb.getStateVoltage())
+           && std::isfinite(clipWDFc.getStateVoltage());
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+float ClippingStageT<Quality>::getLongestTimeConstant() const
+{
+    return std::fmax(ClipWDFa::getTimeConstant(),
+                     std::fmax(ClipWDFb::getTimeConstant(), ClipWDFc<Quality>::getTimeConstant(rPot)));
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+float ClippingStageT<Quality>::processSample(float x, float potValue) noexcept
 {
     setDrive(potValue); 
 
-    const float clipWDFaOut = clipWDFa.processSample(x);
-    const float clipWDFbOut = clipWDFb.processSample(clipWDFaOut);
-    return clipWDFc.processSample(clipWDFbOut);
-}
\ No newline at end of file
+    return processSample(x);
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+float ClippingStageT<Quality>::processSample(float x) noexcept
+{
+    const float clipWDFaOut = TS_PROFILE(ClipA, clipWDFa.processSample(x));
+    const float clipWDFbOut = TS_PROFILE(ClipB, clipWDFb.processSample(clipWDFaOut));
+    return TS_PROFILE(ClipC, clipWDFc.processSample(clipWDFbOut));
+}
+
+template class ClippingStageT<chowdsp::wdft::DiodeQuality::Best>;
+template class ClippingStageT<chowdsp::wdft::DiodeQuality::Good>;
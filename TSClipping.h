@@ -4,20 +4,38 @@
 #include "ClipWDFb.h"
 #include "ClipWDFc.h"
 
-class ClippingStage
+// Quality selects the diode pair equation of the last stage (see DiodePairRoot.h); both are
+// instantiated in TSClipping.cpp, the firmware runs ClippingStage (Best)
+template <chowdsp::wdft::DiodeQuality Quality>
+class ClippingStageT
 {
 public:
-    ClippingStage();
+    using Coefficients = typename ClipWDFc<Quality>::Coefficients;
+
+    ClippingStageT();
     void setDrive(float drive);
+
+    // Precomputed drive settings (see ClipWDFc)
+    Coefficients computeCoefficients(float drive) const { return clipWDFc.computeCoefficients(drive); }
+    void setCoefficients(const Coefficients& c) { clipWDFc.setCoefficients(c); }
+    Coefficients getCoefficients() const { return clipWDFc.getCoefficients(); }
+
     void reset();
     void prepare(float sampleRate);
+    float getStateMagnitude() const; // largest capacitor voltage (C2, C3, C4)
+    bool isFinite() const; // no NaN / Inf in the capacitor states
+    float getLongestTimeConstant() const; // seconds, over the whole drive range
+    void flushDenormals();
     float processSample(float x, float potValue) noexcept;
+    float processSample(float x) noexcept; // uses the drive set by the last setDrive()
 
 private:
 
     ClipWDFa clipWDFa;
     ClipWDFb clipWDFb;
-    ClipWDFc clipWDFc;
+    ClipWDFc<Quality> clipWDFc;
 
-    const float rPot = 500000.0f; // Max pot resistance in ohms
+    static constexpr float rPot = 500000.0f; // Max pot resistance in ohms
 };
+
+using ClippingStage = ClippingStageT<chowdsp::wdft::DiodeQuality::Best>;
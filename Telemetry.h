@@ -0,0 +1,131 @@
+#pragma once
+/**
+ * Telemetry.h - what happened on the audio path, recorded cheaply and reported later
+ *
+ * Features:
+ *  - Event: one fixed-size record (12 bytes): a type, a small id or count, a float value and
+ *    the time in ms. Nothing to format, nothing to allocate.
+ *  - Ring<N>: SpscQueue of events plus a count of the events dropped because the reader
+ *    fell behind. Record() is a few stores and never blocks: when the ring is full the event
+ *    is dropped and counted, and the reader reports the count with its next Drain().
+ *  - Format(): turns one event into a line of text, on the reader's side only.
+ *
+ * One writer (the audio callback) and one reader: the main loop on the Seed, a background
+ * thread on the host (host/sim). Values are printed as fixed point, since newlib-nano's
+ * printf has no %f.
+ *
+ * Usage:
+ *   audio:   ring.Record({ telemetry::Type::Overrun, 0, now, load });
+ *   reader:  ring.Drain([](const telemetry::Event& e) { char s[96]; Format(e, s, sizeof s); Log(s); });
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include "ParamChannel.h"
+
+namespace telemetry {
+
+enum class Type : uint8_t
+{
+    Overrun,     // a callback took longer than its block period; value = load
+    Load,        // highest callback load over the last report period; value = load
+    Param,       // a parameter reached the DSP; id = Param, value = new value
+    Clip,        // output samples at or over full scale in a block; id = count (saturated)
+    NonFinite,   // NaN / Inf in the WDF states; the chain was reset
+    Dropped,     // reader side only: events lost to a full ring; id = count (saturated)
+};
+
+enum Param : uint16_t
+{
+    kParamGain,
+    kParamTone,
+    kParamPreGain,
+    kParamPostGain,
+    kParamEffectOn,
+    kParamPreset,
+};
+
+struct Event
+{
+    Type     type;
+    uint16_t id;
+    uint32_t timeMs;
+    float    value;
+};
+
+template <size_t N = 256>
+class Ring
+{
+  public:
+    // ---------- Writer (audio callback) ----------
+    /** Never blocks; returns false and counts the event as dropped when the ring is full. */
+    bool Record(const Event& event)
+    {
+        if(events_.Push(event))
+            return true;
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // ---------- Reader (main loop / background thread) ----------
+    /** Hands every queued event to sink, preceded by a Dropped event if any were lost. */
+    template <typename Sink>
+    size_t Drain(Sink&& sink)
+    {
+        const uint32_t dropped = dropped_.exchange(0, std::memory_order_relaxed);
+        if(dropped > 0)
+            sink(Event { Type::Dropped, static_cast<uint16_t>(dropped < 0xFFFFu ? dropped : 0xFFFFu), 0, 0.0f });
+
+        size_t count = 0;
+        Event  event;
+        while(events_.Pop(event))
+        {
+            sink(event);
+            ++count;
+        }
+        return count;
+    }
+
+  private:
+    params::SpscQueue<Event, N> events_;
+    std::atomic<uint32_t>       dropped_ { 0 };
+};
+
+inline const char* ParamName(uint16_t id)
+{
+    static const char* const names[] = { "gain", "tone", "pre-gain", "post-gain", "effect", "preset" };
+    return id < sizeof(names) / sizeof(names[0]) ? names[id] : "?";
+}
+
+/** One line of text for an event (no newline); returns the snprintf result. */
+inline int Format(const Event& e, char* out, size_t size)
+{
+    // Fixed point with 3 decimals
+    const float    mag   = e.value < 0.0f ? -e.value : e.value;
+    const uint32_t milli = mag < 4.0e6f ? static_cast<uint32_t>(mag * 1000.0f + 0.5f) : 4000000000u;
+    const char*    sign  = e.value < 0.0f ? "-" : "";
+    const unsigned whole = static_cast<unsigned>(milli / 1000), frac = static_cast<unsigned>(milli % 1000);
+    const unsigned t     = static_cast<unsigned>(e.timeMs);
+
+    switch(e.type)
+    {
+        case Type::Overrun:
+            return std::snprintf(out, size, "%8u ms  overrun, load %u.%03u", t, whole, frac);
+        case Type::Load:
+            return std::snprintf(out, size, "%8u ms  peak load %u.%03u", t, whole, frac);
+        case Type::Param:
+            return std::snprintf(out, size, "%8u ms  %s = %s%u.%03u", t, ParamName(e.id), sign, whole, frac);
+        case Type::Clip:
+            return std::snprintf(out, size, "%8u ms  output clipped, %u samples", t, static_cast<unsigned>(e.id));
+        case Type::NonFinite:
+            return std::snprintf(out, size, "%8u ms  NaN/Inf in the DSP state, chain reset", t);
+        case Type::Dropped:
+            return std::snprintf(out, size, "telemetry: %u events dropped", static_cast<unsigned>(e.id));
+    }
+    return std::snprintf(out, size, "%8u ms  unknown event", t);
+}
+
+} // namespace telemetry
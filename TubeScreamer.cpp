@@ -1,27 +1,320 @@
 #include "TubeScreamer.h"
 
-void TubeScreamer::prepare(float sampleRate)
+#include <cmath>
+
+#include "StageProfiler.h"
+
+static float peakMagnitude(const float* x, size_t numSamples)
+{
+    float peak = 0.0f;
+    for (size_t n = 0; n < numSamples; ++n)
+        peak = std::fmax(peak, std::fabs(x[n]));
+    return peak;
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+void TubeScreamerT<Quality>::prepare(float sampleRate)
 {
+    fs = sampleRate;
     toneFilter.prepare(sampleRate * 2.0f); // Prepare the tone filter for oversampling
     oversampler.prepare();
     clippingStage.prepare(sampleRate); // Prepare the clipping stage
+    driveSmoother.prepare(sampleRate, kParamRampMs);
+    toneSmoother.setCurrentAndTarget(toneFilter.getResistor());
+    toneSmoother.prepare(sampleRate, kParamRampMs);
+    clippingStage.setDrive(driveSmoother.getCurrent());
+    segmentPos = 0;
+    morphSegments = 0;
+    recallPending = false;
+    idle = false;
+    driveModulated = toneModulated = false;
+    buildModulationTables(); // the clipper constants depend on the sample rate
 }
 
-void TubeScreamer::setTone(float R, float C)
+template <chowdsp::wdft::DiodeQuality Quality>
+float TubeScreamerT<Quality>::getLongestTimeConstant() const
 {
+    const float toneR = toneFilter.getResistor() > toneModMax ? toneFilter.getResistor() : toneModMax;
+    const float tone = toneR * toneFilter.getCapacitor();
+    return std::fmax(tone, clippingStage.getLongestTimeConstant());
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+void TubeScreamerT<Quality>::reset()
+{
+    toneFilter.reset();
+    oversampler.prepare();
+    clippingStage.reset();
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+void TubeScreamerT<Quality>::setGain(float g)
+{
+    driveSmoother.setCurrentAndTarget(g);
+    clippingStage.setDrive(g);
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+void TubeScreamerT<Quality>::setTone(float R, float C)
+{
+    toneSmoother.setCurrentAndTarget(R);
     toneFilter.setResistor(R);
     toneFilter.setCapacitor(C);
 }
 
-float TubeScreamer::processSample(float input, float potValue)
+template <chowdsp::wdft::DiodeQuality Quality>
+float TubeScreamerT<Quality>::processSample(float input, float potValue)
+{
+    clippingStage.setDrive(potValue);
+    return processOversampled(input);
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+void TubeScreamerT<Quality>::processBlock(const float* input, float* output, size_t numSamples, float potValue)
+{
+    setGainTarget(potValue);
+    processBlock(input, output, numSamples);
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+void TubeScreamerT<Quality>::processBlock(const float* input, float* output, size_t numSamples)
+{
+    processBlock(input, output, numSamples, nullptr, nullptr);
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+void TubeScreamerT<Quality>::processBlock(const float* input, float* output, size_t numSamples,
+                                          const float* driveMod, const float* toneMod)
+{
+    endModulation(driveModulated && driveMod == nullptr, toneModulated && toneMod == nullptr);
+    driveModulated = (driveMod != nullptr);
+    toneModulated = (toneMod != nullptr);
+
+    const float inputPeak = peakMagnitude(input, numSamples);
+
+    if (idle)
+    {
+        if (inputPeak < idleThreshold)
+        {
+            for (size_t n = 0; n < numSamples; ++n)
+                output[n] = 0.0f;
+            return;
+        }
+        idle = false; // states were cleared on entry, so the chain restarts from rest
+        snapSmoothedCoefficients(); // nothing to glide from after silence
+    }
+
+    if (recallPending)
+        startMorph(); // block boundary: take over the new preset
+
+    // Sub-block segments: the impedance recompute only happens at segment boundaries
+    size_t n = 0;
+    while (n < numSamples)
+    {
+        if (segmentPos == 0)
+            updateSmoothedCoefficients(kSegmentSize);
+
+        const size_t remaining = numSamples - n;
+        const size_t len = (kSegmentSize - segmentPos < remaining) ? kSegmentSize - segmentPos : remaining;
+
+        if (driveMod == nullptr && toneMod == nullptr)
+        {
+            for (size_t k = n; k < n + len; ++k)
+                output[k] = processOversampled(input[k]);
+        }
+        else
+        {
+            // Per-sample table reads override the segment values of the modulated parameters
+            for (size_t k = n; k < n + len; ++k)
+            {
+                if (driveMod != nullptr)
+                    clippingStage.setCoefficients(driveModTable(driveMod[k]));
+                if (toneMod != nullptr)
+                    toneFilter.setResistor(toneModTable(toneMod[k]));
+                output[k] = processOversampled(input[k]);
+            }
+        }
+
+        n += len;
+        segmentPos = (segmentPos + len) % kSegmentSize;
+    }
+
+    if (driveMod != nullptr && numSamples > 0)
+        lastModDrive = driveValueTable(driveMod[numSamples - 1]);
+    if (toneMod != nullptr && numSamples > 0)
+        lastModTone = toneModTable(toneMod[numSamples - 1]);
+
+    if (inputPeak < idleThreshold && getStateMagnitude() < idleThreshold)
+    {
+        reset(); // drop the sub-threshold residue so the idle output is exactly zero
+        idle = true;
+    }
+    else if (flushDenormals)
+    {
+        clippingStage.flushDenormals();
+        toneFilter.flushDenormals();
+        oversampler.flushDenormals();
+    }
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+typename TubeScreamerT<Quality>::Coefficients
+TubeScreamerT<Quality>::computeCoefficients(float drive, float toneR, float toneC) const
+{
+    return { drive, toneR, toneC, clippingStage.computeCoefficients(drive) };
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+void TubeScreamerT<Quality>::setDriveModulationRange(float minDrive, float maxDrive)
+{
+    driveModMin = minDrive;
+    driveModMax = maxDrive;
+    buildModulationTables();
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+void TubeScreamerT<Quality>::setToneModulationRange(float minR, float maxR)
+{
+    toneModMin = minR;
+    toneModMax = maxR;
+    buildModulationTables();
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+void TubeScreamerT<Quality>::buildModulationTables()
+{
+    auto drive = [this](float pos) { return driveModMin + pos * (driveModMax - driveModMin); };
+    driveValueTable.build(drive);
+    driveModTable.build([this, drive](float pos) { return clippingStage.computeCoefficients(drive(pos)); });
+
+    // Same audio taper as the tone pot; fall back to linear unless both ends are positive
+    if (toneModMin > 0.0f && toneModMax > 0.0f)
+        toneModTable.build([this](float pos) { return toneModMin * std::pow(toneModMax / toneModMin, pos); });
+    else
+        toneModTable.build([this](float pos) { return toneModMin + pos * (toneModMax - toneModMin); });
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+void TubeScreamerT<Quality>::endModulation(bool driveWasModulated, bool toneWasModulated)
+{
+    // Glide from where the modulation left the parameter back to its smoothed target
+    if (driveWasModulated)
+    {
+        const float target = driveSmoother.getTarget();
+        driveSmoother.setCurrentAndTarget(lastModDrive);
+        driveSmoother.setTarget(target);
+        clippingStage.setDrive(lastModDrive);
+    }
+    if (toneWasModulated)
+    {
+        const float target = toneSmoother.getTarget();
+        toneSmoother.setCurrentAndTarget(lastModTone);
+        toneSmoother.setTarget(target);
+        toneFilter.setResistor(lastModTone);
+    }
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+void TubeScreamerT<Quality>::startMorph()
+{
+    morphFrom = { driveSmoother.getCurrent(), toneFilter.getResistor(), toneFilter.getCapacitor(),
+                  clippingStage.getCoefficients() };
+    morphTo = pendingRecall;
+    recallPending = false;
+
+    // The smoothers idle during the morph. Parked on the preset, they show at its end whether
+    // a setGainTarget() / setToneTarget() arrived meanwhile
+    driveSmoother.setCurrentAndTarget(morphTo.drive);
+    toneSmoother.setCurrentAndTarget(morphTo.toneR);
+
+    const size_t segments = static_cast<size_t>(kMorphMs * 0.001f * fs / kSegmentSize);
+    morphSegments = (segments > 0) ? segments : 1;
+    morphSegment = 0;
+    segmentPos = 0; // first morph step right away
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+void TubeScreamerT<Quality>::applyCoefficients(const Coefficients& c)
+{
+    clippingStage.setCoefficients(c.clip);
+    toneFilter.setResistor(c.toneR);
+    toneFilter.setCapacitor(c.toneC);
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+void TubeScreamerT<Quality>::updateSmoothedCoefficients(size_t numSamples)
+{
+    if (morphSegments > 0)
+    {
+        if (++morphSegment < morphSegments)
+        {
+            const float t = static_cast<float>(morphSegment) / static_cast<float>(morphSegments);
+            auto lerp = [t](float a, float b) { return a + t * (b - a); };
+            applyCoefficients({ lerp(morphFrom.drive, morphTo.drive), lerp(morphFrom.toneR, morphTo.toneR),
+                                lerp(morphFrom.toneC, morphTo.toneC),
+                                ClipWDFc<Quality>::interpolate(morphFrom.clip, morphTo.clip, t) });
+            return;
+        }
+
+        // Morph done: land exactly on the preset, then glide on to any target set meanwhile
+        applyCoefficients(morphTo);
+        const float driveTarget = driveSmoother.getTarget();
+        const float toneTarget = toneSmoother.getTarget();
+        driveSmoother.setCurrentAndTarget(morphTo.drive);
+        toneSmoother.setCurrentAndTarget(morphTo.toneR);
+        driveSmoother.setTarget(driveTarget);
+        toneSmoother.setTarget(toneTarget);
+        morphSegments = 0;
+        return;
+    }
+
+    // A modulated parameter is set per sample from its table; the smoother takes over again
+    // in endModulation()
+    if (driveSmoother.isSmoothing() && !driveModulated)
+        clippingStage.setDrive(driveSmoother.skip(numSamples));
+    if (toneSmoother.isSmoothing() && !toneModulated)
+        toneFilter.setResistor(toneSmoother.skip(numSamples));
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+void TubeScreamerT<Quality>::snapSmoothedCoefficients()
+{
+    if (driveSmoother.isSmoothing())
+        setGain(driveSmoother.getTarget());
+    if (toneSmoother.isSmoothing())
+    {
+        toneSmoother.setCurrentAndTarget(toneSmoother.getTarget());
+        toneFilter.setResistor(toneSmoother.getTarget());
+    }
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+bool TubeScreamerT<Quality>::hasFiniteState() const
+{
+    return clippingStage.isFinite() && std::isfinite(toneFilter.getStateVoltage()) && oversampler.isFinite();
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+float TubeScreamerT<Quality>::getStateMagnitude() const
+{
+    return std::fmax(clippingStage.getStateMagnitude(),
+                     std::fmax(std::fabs(toneFilter.getStateVoltage()), oversampler.getStateMagnitude()));
+}
+
+template <chowdsp::wdft::DiodeQuality Quality>
+inline float TubeScreamerT<Quality>::processOversampled(float input)
 {
     float x1, x2;
-    oversampler.upsample(input, x1, x2);
+    TS_PROFILE(Upsample, oversampler.upsample(input, x1, x2));
 
-    //float y1 = toneFilter.processSample(clippingStage.processSample(x1, potValue)); // Not used for upsampling
-    float y2 = toneFilter.processSample(clippingStage.processSample(x2, potValue));
-    //float y1 = clippingStage.processSample(x1, potValue); // No tone control for now
-    //float y2 = clippingStage.processSample(x2, potValue);
+    //float y1 = toneFilter.processSample(clippingStage.processSample(x1)); // Not used for upsampling
+    const float clipped = clippingStage.processSample(x2); // profiled per WDF inside
+    float y2 = TS_PROFILE(Tone, toneFilter.processSample(clipped));
+    //float y1 = clippingStage.processSample(x1); // No tone control for now
+    //float y2 = clippingStage.processSample(x2);
 
-    return oversampler.downsample(y2);
+    return TS_PROFILE(Downsample, oversampler.downsample(y2));
 }
+
+template class TubeScreamerT<chowdsp::wdft::DiodeQuality::Best>;
+template class TubeScreamerT<chowdsp::wdft::DiodeQuality::Good>;
@@ -1,20 +1,140 @@
 #pragma once
 
+#include <stddef.h>
+
 #include "RCFilter.h"
 #include "Oversampler2x.h"
 #include "TSClipping.h"
+#include "ParamSmoother.h"
+#include "ModulationTable.h"
 
-class TubeScreamer
+// Quality is the diode pair equation: Best is eqn (39) of Werner et al., two omega4() calls per
+// sample; Good is eqn (18), one call, cheaper and slightly less accurate when clipping hard.
+// It is fixed at compile time so the sample path has no branch for it. The firmware runs
+// TubeScreamer (Best); TubeScreamer.cpp instantiates both for the host tools.
+template <chowdsp::wdft::DiodeQuality Quality>
+class TubeScreamerT
 {
 public:
+    // Every adapted constant of the chain for one setting, ready to be installed without any
+    // transcendental math. Used for preset recall.
+    struct Coefficients
+    {
+        float drive;
+        float toneR;
+        float toneC;
+        typename ClippingStageT<Quality>::Coefficients clip;
+    };
+
     void prepare(float sampleRate);
+    void reset();
     float processSample(float input, float potValue);
 
-    void setGain(float g) { clippingStage.setDrive(g); }
+    // Processes any number of samples; input and output may point to the same buffer.
+    // Drive and tone glide towards their targets, with the impedances recomputed once every
+    // kSegmentSize samples rather than per sample.
+    // Once the input and every internal state have decayed below the idle threshold the
+    // chain is reset and skipped, and the output is exact silence until the input returns.
+    void processBlock(const float* input, float* output, size_t numSamples);
+    void processBlock(const float* input, float* output, size_t numSamples, float potValue);
+
+    // Immediate changes (no smoothing)
+    void setGain(float g);
     void setTone(float R, float C);
 
+    // Smoothed changes, applied by processBlock()
+    void setGainTarget(float g) { driveSmoother.setTarget(g); }
+    void setToneTarget(float R) { toneSmoother.setTarget(R); }
+
+    static constexpr size_t kSegmentSize = 16;   // samples between coefficient updates
+    static constexpr float kParamRampMs = 20.0f; // drive / tone glide time
+
+    // Precomputes a setting at the prepared sample rate (safe to call from a non-audio context)
+    Coefficients computeCoefficients(float drive, float toneR, float toneC) const;
+
+    // Swaps to a precomputed setting at the start of the next block and morphs the current
+    // coefficients into it over kMorphMs. The state is kept, so nothing is reset.
+    void recallCoefficients(const Coefficients& target)
+    {
+        pendingRecall = target;
+        recallPending = true;
+    }
+
+    static constexpr float kMorphMs = 10.0f;
+
+    // Audio-rate modulation (expression pedal, LFO, envelope follower). driveMod and toneMod
+    // hold one 0..1 position per sample, mapped onto the ranges below through precomputed
+    // coefficient tables, so the sample loop runs no log()/pow(). Either may be nullptr to
+    // leave that parameter on its smoothed target; when a modulation stops, the parameter
+    // glides back from the last modulated value.
+    void processBlock(const float* input, float* output, size_t numSamples,
+                      const float* driveMod, const float* toneMod);
+
+    // Ranges covered by a 0..1 modulation: drive is linear in pot resistance, tone follows the
+    // log taper of the tone pot. They rebuild the tables, so call them outside the audio thread.
+    void setDriveModulationRange(float minDrive, float maxDrive);
+    void setToneModulationRange(float minR, float maxR);
+
+    static constexpr size_t kModTableSize = 129;
+
+    // Silence detection. A threshold of 0 disables idle mode.
+    void setIdleThreshold(float threshold) { idleThreshold = threshold; }
+    bool isIdle() const { return idle; }
+
+    // Longest time constant of the circuit state (the capacitors) in seconds, over the full
+    // drive and tone ranges: how long the output still depends on past input. Parameter
+    // glides come on top while the settings move (kParamRampMs).
+    float getLongestTimeConstant() const;
+
+    // Zero near-subnormal states once per block. Can be turned off on threads running
+    // under denormals::ScopedNoDenormals, where the FPU already flushes them.
+    void setDenormalFlushing(bool shouldFlush) { flushDenormals = shouldFlush; }
+
+    // False once a NaN or Inf has got into any state; the chain then stays broken until reset().
+    bool hasFiniteState() const;
+
 private:
+    float processOversampled(float input);
+    float getStateMagnitude() const;
+    void updateSmoothedCoefficients(size_t numSamples);
+    void snapSmoothedCoefficients();
+    void startMorph();
+    void applyCoefficients(const Coefficients& c);
+    void buildModulationTables();
+    void endModulation(bool driveWasModulated, bool toneWasModulated);
+
     RCFilter toneFilter { 1000.0f, 47e-9f };
     Oversampler2x oversampler;
-    ClippingStage clippingStage;
+    ClippingStageT<Quality> clippingStage;
+
+    LinearSmoother driveSmoother;
+    LinearSmoother toneSmoother;
+    size_t segmentPos = 0;
+
+    float fs = 48000.0f;
+    Coefficients pendingRecall {};
+    bool recallPending = false;
+    Coefficients morphFrom {};
+    Coefficients morphTo {};
+    size_t morphSegment = 0;
+    size_t morphSegments = 0; // 0 = not morphing
+
+    ModulationTable<typename ClippingStageT<Quality>::Coefficients, kModTableSize, ClipWDFc<Quality>::interpolate>
+        driveModTable;
+    ModulationTable<float, kModTableSize, lerpFloat> driveValueTable;
+    ModulationTable<float, kModTableSize, lerpFloat> toneModTable;
+    float driveModMin = 0.0f;
+    float driveModMax = 500000.0f;
+    float toneModMin = 1000.0f;
+    float toneModMax = 20000.0f;
+    bool driveModulated = false; // last block ran with a drive modulation buffer
+    bool toneModulated = false;
+    float lastModDrive = 0.0f;
+    float lastModTone = 0.0f;
+
+    float idleThreshold = 1.0e-5f; // -100 dBFS
+    bool idle = false;
+    bool flushDenormals = true;
 };
+
+using TubeScreamer = TubeScreamerT<chowdsp::wdft::DiodeQuality::Best>;
@@ -0,0 +1,292 @@
+#include "MappedWav.h"
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "SampleConvert.h"
+
+namespace wav {
+
+namespace {
+
+// Read-ahead window. Larger windows measured slower, cold and warm: WILLNEED is issued
+// synchronously and a big one stalls the reader, while the kernel's own sequential
+// read-ahead already covers the rest. 2 MB roughly matched the best of both.
+constexpr uint64_t kWindowBytes = 2u << 20;
+// Pages behind the cursor are released in batches of this size
+constexpr uint64_t kReleaseBytes = 64u << 20;
+
+uint32_t ReadU32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24); }
+uint64_t ReadU64(const uint8_t* p) { return ReadU32(p) | (static_cast<uint64_t>(ReadU32(p + 4)) << 32); }
+
+bool Fail(std::string* error, const std::string& what)
+{
+    if(error != nullptr)
+        *error = what;
+    return false;
+}
+
+uint64_t PageFloor(uint64_t x)
+{
+    const uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    return x - x % page;
+}
+
+} // namespace
+
+MappedReader::~MappedReader()
+{
+    Close();
+}
+
+void MappedReader::Close()
+{
+    if(map_ != nullptr)
+        munmap(map_, size_);
+    if(fd_ >= 0)
+        close(fd_);
+    map_    = nullptr;
+    fd_     = -1;
+    size_   = 0;
+    info_   = Info{};
+    direct_ = false;
+    cursor_ = ahead_ = dropped_ = 0;
+}
+
+bool MappedReader::Map(const std::string& path, std::string* error)
+{
+    Close();
+    fd_ = open(path.c_str(), O_RDONLY);
+    if(fd_ < 0)
+        return Fail(error, "cannot open " + path);
+
+    struct stat st;
+    if(fstat(fd_, &st) != 0 || st.st_size == 0)
+        return Fail(error, path + ": empty or unreadable");
+    size_ = static_cast<uint64_t>(st.st_size);
+
+    void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if(p == MAP_FAILED)
+    {
+        size_ = 0;
+        return Fail(error, path + ": mmap failed");
+    }
+    map_ = static_cast<uint8_t*>(p);
+    madvise(map_, size_, MADV_SEQUENTIAL);
+    return true;
+}
+
+bool MappedReader::Open(const std::string& path, std::string* error)
+{
+    if(!Map(path, error))
+        return false;
+
+    const bool rf64 = size_ >= 12 && std::memcmp(map_, "RF64", 4) == 0;
+    if(size_ < 12 || (!rf64 && std::memcmp(map_, "RIFF", 4) != 0) || std::memcmp(map_ + 8, "WAVE", 4) != 0)
+        return Fail(error, path + ": not a RIFF/WAVE or RF64 file");
+
+    // Walk the chunk headers; each chunk is padded to an even size. In RF64 the 32-bit data
+    // size is 0xFFFFFFFF and the real one is in the ds64 chunk that comes first.
+    bool     haveFmt   = false;
+    uint64_t ds64Data  = 0;
+    uint64_t dataBytes = 0;
+    uint64_t pos       = 12;
+    while(true)
+    {
+        if(pos + 8 > size_)
+            return Fail(error, path + ": missing fmt or data chunk");
+        const uint8_t* chunk = map_ + pos;
+        uint64_t       size  = ReadU32(chunk + 4);
+        const uint64_t avail = size_ - (pos + 8);
+
+        if(std::memcmp(chunk, "ds64", 4) == 0 && size >= 16 && avail >= 16)
+            ds64Data = ReadU64(chunk + 16);
+        else if(std::memcmp(chunk, "fmt ", 4) == 0)
+        {
+            if(!DecodeFmt(chunk + 8, size < avail ? size : avail, info_))
+                return Fail(error, path + ": unsupported sample format");
+            haveFmt = true;
+        }
+        else if(std::memcmp(chunk, "data", 4) == 0)
+        {
+            if(rf64 && size == 0xFFFFFFFFu)
+                size = ds64Data;
+            info_.dataOffset = pos + 8;
+            dataBytes        = (size <= avail) ? size : avail; // tolerate truncated files
+            break;
+        }
+        pos += 8 + size + (size & 1);
+    }
+
+    if(!haveFmt)
+        return Fail(error, path + ": missing fmt chunk");
+
+    info_.frames = dataBytes / (BytesPerSample(info_.format) * info_.channels);
+    direct_      = info_.format == Format::Float32 && info_.dataOffset % sizeof(float) == 0;
+    return true;
+}
+
+bool MappedReader::OpenRaw(const std::string& path, float sampleRate, size_t channels, std::string* error)
+{
+    if(channels == 0 || sampleRate <= 0.0f)
+        return Fail(error, path + ": raw input needs a sample rate and channel count");
+    if(!Map(path, error))
+        return false;
+
+    info_.sampleRate = sampleRate;
+    info_.channels   = channels;
+    info_.format     = Format::Float32;
+    info_.dataOffset = 0;
+    info_.frames     = size_ / (sizeof(float) * channels);
+    direct_          = true;
+    return true;
+}
+
+void MappedReader::Advance(uint64_t frames)
+{
+    cursor_ += frames;
+    const uint64_t pos = info_.dataOffset + cursor_ * BytesPerSample(info_.format) * info_.channels;
+
+    // Keep a window in flight ahead of the cursor, so the kernel reads while the previous one
+    // is processed
+    if(pos + kWindowBytes > ahead_ && ahead_ < size_)
+    {
+        const uint64_t from = PageFloor(pos > ahead_ ? pos : ahead_);
+        const uint64_t to   = (pos + 2 * kWindowBytes < size_) ? pos + 2 * kWindowBytes : size_;
+        madvise(map_ + from, to - from, MADV_WILLNEED);
+        ahead_ = to;
+    }
+
+    // Release what lies well behind: the page cache keeps it, this process stops holding it
+    if(pos > dropped_ + 2 * kReleaseBytes)
+    {
+        const uint64_t to = PageFloor(pos - kReleaseBytes);
+        madvise(map_ + dropped_, to - dropped_, MADV_DONTNEED);
+        dropped_ = to;
+    }
+}
+
+void MappedReader::Seek(uint64_t frame)
+{
+    cursor_ = (frame < info_.frames) ? frame : info_.frames;
+    ahead_ = dropped_ = PageFloor(info_.dataOffset + cursor_ * BytesPerSample(info_.format) * info_.channels);
+    Advance(0);
+}
+
+const float* MappedReader::ReadDirect(size_t& frames)
+{
+    if(!direct_ || cursor_ >= info_.frames)
+        return nullptr;
+    if(frames > info_.frames - cursor_)
+        frames = static_cast<size_t>(info_.frames - cursor_);
+
+    const float* p = reinterpret_cast<const float*>(map_ + info_.dataOffset) + cursor_ * info_.channels;
+    Advance(frames);
+    return p;
+}
+
+size_t MappedReader::Read(float* interleaved, size_t frames)
+{
+    if(map_ == nullptr || cursor_ >= info_.frames)
+        return 0;
+    if(frames > info_.frames - cursor_)
+        frames = static_cast<size_t>(info_.frames - cursor_);
+
+    const size_t   samples = frames * info_.channels;
+    const size_t   bytes   = BytesPerSample(info_.format);
+    const uint8_t* src     = map_ + info_.dataOffset + cursor_ * bytes * info_.channels;
+    switch(info_.format)
+    {
+        // PCM data is only 2-byte aligned in general: copy through memcpy rather than cast
+        case Format::Pcm24: convert::Int24ToFloat(src, interleaved, samples); break;
+        case Format::Float32: std::memcpy(interleaved, src, samples * sizeof(float)); break;
+        case Format::Pcm16:
+        case Format::Pcm32:
+            for(size_t done = 0; done < samples;)
+            {
+                constexpr size_t kBatch = 1024;
+                int32_t          tmp[kBatch];
+                const size_t     n = (samples - done < kBatch) ? samples - done : kBatch;
+                std::memcpy(tmp, src + done * bytes, n * bytes);
+                if(info_.format == Format::Pcm16)
+                    convert::Int16ToFloat(reinterpret_cast<const int16_t*>(tmp), interleaved + done, n);
+                else
+                    convert::Int32ToFloat(tmp, interleaved + done, n);
+                done += n;
+            }
+            break;
+    }
+    Advance(frames);
+    return frames;
+}
+
+// ---------------- MappedWriter ----------------
+
+MappedWriter::~MappedWriter()
+{
+    Close();
+}
+
+bool MappedWriter::Open(const std::string& path, float sampleRate, size_t channels, Format format, uint64_t frames,
+                        std::string* error)
+{
+    Close();
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd_ < 0)
+        return Fail(error, "cannot write " + path);
+
+    const uint64_t dataBytes = frames * channels * BytesPerSample(format);
+    size_                    = kHeaderSize + dataBytes;
+    if(ftruncate(fd_, static_cast<off_t>(size_)) != 0)
+        return Fail(error, path + ": cannot allocate " + std::to_string(size_) + " bytes");
+
+    void* p = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if(p == MAP_FAILED)
+    {
+        size_ = 0;
+        return Fail(error, path + ": mmap failed");
+    }
+    map_      = static_cast<uint8_t*>(p);
+    channels_ = channels;
+    format_   = format;
+    frames_   = frames;
+    MakeHeader(map_, sampleRate, channels, format, dataBytes);
+    return true;
+}
+
+bool MappedWriter::Write(uint64_t frame, const float* interleaved, size_t frames)
+{
+    if(map_ == nullptr || frame + frames > frames_)
+        return false;
+
+    // The data starts at kHeaderSize (80), so 16- and 32-bit samples are naturally aligned
+    const size_t samples = frames * channels_;
+    uint8_t*     dst     = map_ + kHeaderSize + frame * channels_ * BytesPerSample(format_);
+    switch(format_)
+    {
+        case Format::Pcm16: convert::FloatToInt16(interleaved, reinterpret_cast<int16_t*>(dst), samples); break;
+        case Format::Pcm24: convert::FloatToInt24(interleaved, dst, samples); break;
+        case Format::Pcm32: convert::FloatToInt32(interleaved, reinterpret_cast<int32_t*>(dst), samples); break;
+        case Format::Float32: std::memcpy(dst, interleaved, samples * sizeof(float)); break;
+    }
+    return true;
+}
+
+bool MappedWriter::Close()
+{
+    bool ok = true;
+    if(map_ != nullptr)
+        ok = msync(map_, size_, MS_SYNC) == 0 && munmap(map_, size_) == 0;
+    if(fd_ >= 0)
+        ok = (close(fd_) == 0) && ok;
+    map_  = nullptr;
+    fd_   = -1;
+    size_ = 0;
+    return ok;
+}
+
+} // namespace wav
@@ -0,0 +1,99 @@
+#pragma once
+/**
+ * MappedWav.h - memory-mapped input for long recordings (host only, POSIX)
+ *
+ * MappedReader maps the whole file read-only and walks it front to back:
+ *  - RIFF/WAVE and RF64 (data sizes over 4 GB via the ds64 chunk), or headerless float32
+ *    with the rate and channel count given by the caller (OpenRaw).
+ *  - madvise(MADV_SEQUENTIAL) on the mapping, MADV_WILLNEED on a short window ahead of the
+ *    cursor and MADV_DONTNEED well behind it, so resident memory stays bounded on multi-hour
+ *    files.
+ *  - ReadDirect() returns float32 frames straight from the mapping with no copy; Read()
+ *    converts like wav::Reader for the PCM formats. Seek() allows starting anywhere.
+ *
+ * MappedWriter is the output side for renders split across threads: a WAV (RF64 over 4 GB)
+ * of known length whose frames are converted straight into a shared mapping, in any order.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "WavFile.h"
+
+namespace wav {
+
+class MappedReader
+{
+  public:
+    MappedReader() = default;
+    ~MappedReader();
+    MappedReader(const MappedReader&) = delete;
+    MappedReader& operator=(const MappedReader&) = delete;
+
+    /** RIFF/WAVE or RF64. Returns false and fills error (if given) on unreadable or unsupported files. */
+    bool Open(const std::string& path, std::string* error = nullptr);
+    /** Headerless interleaved float32 (native endianness). */
+    bool OpenRaw(const std::string& path, float sampleRate, size_t channels, std::string* error = nullptr);
+    void Close();
+
+    const Info& GetInfo() const { return info_; }
+
+    /** True when the samples are float32 at a float-aligned offset, i.e. ReadDirect() works. */
+    bool IsDirect() const { return direct_; }
+
+    /**
+     * Returns up to frames interleaved frames in place in the mapping and advances past them;
+     * frames is set to the number returned. nullptr (and no advance) if !IsDirect() or at the end.
+     */
+    const float* ReadDirect(size_t& frames);
+
+    /** Reads up to frames frames into interleaved; returns the number read (0 at the end). */
+    size_t Read(float* interleaved, size_t frames);
+
+    /** Moves the read position to frame (clamped to the end). */
+    void Seek(uint64_t frame);
+
+  private:
+    bool Map(const std::string& path, std::string* error);
+    void Advance(uint64_t frames);
+
+    int       fd_      = -1;
+    uint8_t*  map_     = nullptr;
+    uint64_t  size_    = 0;
+    Info      info_;
+    bool      direct_  = false;
+    uint64_t  cursor_  = 0; // frames consumed
+    uint64_t  ahead_   = 0; // byte offset up to which WILLNEED has been issued
+    uint64_t  dropped_ = 0; // byte offset below which pages have been released
+};
+
+/** Fixed-length WAV written through a shared mapping. */
+class MappedWriter
+{
+  public:
+    MappedWriter() = default;
+    ~MappedWriter();
+    MappedWriter(const MappedWriter&) = delete;
+    MappedWriter& operator=(const MappedWriter&) = delete;
+
+    /** Creates the file at its full size, header included. */
+    bool Open(const std::string& path, float sampleRate, size_t channels, Format format, uint64_t frames,
+              std::string* error = nullptr);
+
+    /** Converts frames into the file at position frame. Safe from several threads at once for disjoint ranges. */
+    bool Write(uint64_t frame, const float* interleaved, size_t frames);
+
+    /** Flushes and unmaps; returns false if the data could not be written back. */
+    bool Close();
+
+  private:
+    int      fd_       = -1;
+    uint8_t* map_      = nullptr;
+    uint64_t size_     = 0;
+    size_t   channels_ = 1;
+    Format   format_   = Format::Float32;
+    uint64_t frames_   = 0;
+};
+
+} // namespace wav
@@ -0,0 +1,119 @@
+#include "PresetFile.h"
+
+#include <cstdlib>
+#include <fstream>
+
+namespace presets {
+
+namespace {
+
+constexpr PresetParams kDefaultParams = { 10.0f, 10000.0f, 47e-9f, 1.0f, 1.0f };
+
+std::string Trim(const std::string& s)
+{
+    const size_t first = s.find_first_not_of(" \t\r");
+    if(first == std::string::npos)
+        return {};
+    const size_t last = s.find_last_not_of(" \t\r");
+    return s.substr(first, last - first + 1);
+}
+
+bool Fail(std::string* error, size_t line, const std::string& what)
+{
+    if(error != nullptr)
+        *error = "line " + std::to_string(line) + ": " + what;
+    return false;
+}
+
+float* Field(PresetParams& p, const std::string& key)
+{
+    if(key == "drive") return &p.drive;
+    if(key == "tone")  return &p.toneR;
+    if(key == "toneC") return &p.toneC;
+    if(key == "pre")   return &p.preGain;
+    if(key == "post")  return &p.postGain;
+    return nullptr;
+}
+
+} // namespace
+
+bool ParsePresets(std::istream& in, std::vector<NamedPreset>& out, std::string* error)
+{
+    std::vector<NamedPreset> parsed;
+    std::string              raw;
+    size_t                   lineNo = 0;
+
+    while(std::getline(in, raw))
+    {
+        ++lineNo;
+        const std::string line = Trim(raw.substr(0, raw.find('#')));
+        if(line.empty())
+            continue;
+
+        if(line.front() == '[')
+        {
+            if(line.back() != ']' || line.size() < 3)
+                return Fail(error, lineNo, "bad section header");
+            parsed.push_back({ Trim(line.substr(1, line.size() - 2)), kDefaultParams });
+            continue;
+        }
+
+        const size_t eq = line.find('=');
+        if(eq == std::string::npos)
+            return Fail(error, lineNo, "expected key = value");
+        if(parsed.empty())
+            return Fail(error, lineNo, "key outside of a [preset] section");
+
+        const std::string key   = Trim(line.substr(0, eq));
+        const std::string value = Trim(line.substr(eq + 1));
+        float*            field = Field(parsed.back().params, key);
+        if(field == nullptr)
+            return Fail(error, lineNo, "unknown key '" + key + "'");
+
+        char*       end = nullptr;
+        const float v   = std::strtof(value.c_str(), &end);
+        if(value.empty() || *end != '\0')
+            return Fail(error, lineNo, "bad number '" + value + "'");
+        *field = v;
+    }
+
+    out = std::move(parsed);
+    return true;
+}
+
+void FormatPresets(std::ostream& out, const std::vector<NamedPreset>& presets)
+{
+    for(const NamedPreset& p : presets)
+    {
+        out << '[' << p.name << "]\n"
+            << "drive = " << p.params.drive << '\n'
+            << "tone = " << p.params.toneR << '\n'
+            << "toneC = " << p.params.toneC << '\n'
+            << "pre = " << p.params.preGain << '\n'
+            << "post = " << p.params.postGain << "\n\n";
+    }
+}
+
+bool ReadPresetFile(const std::string& path, std::vector<NamedPreset>& out, std::string* error)
+{
+    std::ifstream in(path);
+    if(!in)
+    {
+        if(error != nullptr)
+            *error = "cannot open " + path;
+        return false;
+    }
+    return ParsePresets(in, out, error);
+}
+
+bool WritePresetFile(const std::string& path, const std::vector<NamedPreset>& presets)
+{
+    std::ofstream out(path);
+    if(!out)
+        return false;
+    out.precision(9); // round-trips a float exactly
+    FormatPresets(out, presets);
+    return static_cast<bool>(out);
+}
+
+} // namespace presets
@@ -0,0 +1,39 @@
+#pragma once
+/**
+ * PresetFile.h - host-side text format for presets
+ *
+ * One section per preset, keys in any order, '#' starts a comment:
+ *
+ *   [Lead]
+ *   drive = 250000   # drive pot resistance in ohms
+ *   tone  = 8000     # tone resistor in ohms
+ *   toneC = 47e-9    # tone capacitor in farads (optional, default 47 nF)
+ *   pre   = 1.0      # pre-gain (optional, default 1)
+ *   post  = 1.2      # post-gain (optional, default 1)
+ *
+ * Only the player-facing settings are stored; the coefficients are computed at the
+ * sample rate of whatever loads the file (PresetBank::Store).
+ */
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Presets.h"
+
+namespace presets {
+
+struct NamedPreset
+{
+    std::string  name;
+    PresetParams params;
+};
+
+/** Parses every section; on failure returns false and describes the first bad line in error. */
+bool ParsePresets(std::istream& in, std::vector<NamedPreset>& out, std::string* error = nullptr);
+void FormatPresets(std::ostream& out, const std::vector<NamedPreset>& presets);
+
+bool ReadPresetFile(const std::string& path, std::vector<NamedPreset>& out, std::string* error = nullptr);
+bool WritePresetFile(const std::string& path, const std::vector<NamedPreset>& presets);
+
+} // namespace presets
@@ -0,0 +1,169 @@
+#include "ReferenceChain.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "TubeScreamer.h"
+
+namespace reference {
+
+double ExactDiodePair::reflected() noexcept
+{
+    // With u = |v| / Vt the equation becomes h(u) = u + 2k sinh(u) - |a| / Vt = 0, k = R Is / Vt.
+    // h is increasing and convex for u >= 0, so Newton from a point right of the root
+    // converges monotonically. Both |a| / Vt and asinh(|a| / (2k Vt)) are such points.
+    const double A = std::fabs(wdf.a) / Vt;
+    const double k = portR * Is / Vt;
+
+    double u = std::min(A, std::asinh(A / (2.0 * k)));
+    for(int i = 0; i < 100; ++i)
+    {
+        const double step = (u + 2.0 * k * std::sinh(u) - A) / (1.0 + 2.0 * k * std::cosh(u));
+        u -= step;
+        if(std::fabs(step) <= 1e-16 * (1.0 + u))
+            break;
+    }
+
+    const double v = std::copysign(Vt * u, wdf.a);
+    wdf.b          = 2.0 * v - wdf.a;
+    return wdf.b;
+}
+
+void Chain::Glide::set(double value)
+{
+    current = target = value;
+    step             = 0.0;
+    remaining        = 0;
+}
+
+void Chain::Glide::setTarget(double value, size_t ramp)
+{
+    if(value == target)
+        return;
+    target    = value;
+    remaining = ramp;
+    step      = (target - current) / static_cast<double>(ramp);
+}
+
+double Chain::Glide::next()
+{
+    if(remaining == 0)
+        return current;
+    current = (--remaining == 0) ? target : current + step;
+    return current;
+}
+
+void Chain::prepare(double sampleRate)
+{
+    c2.prepare(sampleRate);
+    c3.prepare(sampleRate);
+    c4.prepare(sampleRate);
+    toneC.prepare(2.0 * sampleRate);
+
+    // Same ramp length as LinearSmoother
+    const double samples = sampleRate * TubeScreamer::kParamRampMs * 0.001;
+    rampSamples          = samples > 1.0 ? static_cast<size_t>(samples) : 1;
+
+    applyDrive(drive.current);
+    reset();
+}
+
+void Chain::reset()
+{
+    c2.reset();
+    c3.reset();
+    c4.reset();
+    toneC.reset();
+    toneC.wdf.a = toneC.wdf.b = 0.0; // the tone filter's capacitor waves are state too (see RCFilter)
+    y1 = y2 = 0.0;
+}
+
+void Chain::applyDrive(double potR)
+{
+    is.setResistanceValue(kR6 + potR);
+}
+
+void Chain::setDrive(double potR)
+{
+    drive.set(potR);
+    applyDrive(potR);
+}
+
+void Chain::setTone(double R, double C)
+{
+    toneGlide.set(R);
+    toneR.setResistanceValue(R);
+    toneC.setCapacitanceValue(C);
+}
+
+void Chain::setDriveTarget(double potR)
+{
+    drive.setTarget(potR, rampSamples);
+}
+
+void Chain::setToneTarget(double R)
+{
+    toneGlide.setTarget(R, rampSamples);
+}
+
+void Chain::setDriveModulationRange(double minDrive, double maxDrive)
+{
+    driveModMin = minDrive;
+    driveModMax = maxDrive;
+}
+
+void Chain::setToneModulationRange(double minR, double maxR)
+{
+    toneModMin = minR;
+    toneModMax = maxR;
+}
+
+double Chain::processSample(double x)
+{
+    // Clipper at the base rate; only the second (held) sample of the 2x pair is processed,
+    // as in TubeScreamer::processOversampled()
+    vsA.setVoltage(x);
+    vsA.incident(a3.reflected());
+    const double va = chowdsp::wdft::voltage<double>(r5);
+    a3.incident(vsA.reflected());
+
+    vsB.setVoltage(va);
+    vsB.incident(b1.reflected());
+    const double ib = chowdsp::wdft::current<double>(r4);
+    b1.incident(vsB.reflected());
+
+    is.setCurrent(ib);
+    dp.incident(c1.reflected());
+    const double vc = chowdsp::wdft::voltage<double>(c4);
+    c1.incident(dp.reflected());
+
+    tone.incident(vc);
+    tone.reflected();
+    const double y0 = chowdsp::wdft::voltage<double>(tone);
+
+    const double y = 0.25 * y2 + 0.5 * y1 + 0.25 * y0;
+    y2             = y1;
+    y1             = y0;
+    return y;
+}
+
+void Chain::process(const float* input, double* output, size_t numSamples, const float* driveMod,
+                    const float* toneMod)
+{
+    for(size_t n = 0; n < numSamples; ++n)
+    {
+        if(driveMod != nullptr)
+            applyDrive(driveModMin + static_cast<double>(driveMod[n]) * (driveModMax - driveModMin));
+        else if(drive.remaining > 0)
+            applyDrive(drive.next());
+
+        if(toneMod != nullptr)
+            toneR.setResistanceValue(toneModMin * std::pow(toneModMax / toneModMin, static_cast<double>(toneMod[n])));
+        else if(toneGlide.remaining > 0)
+            toneR.setResistanceValue(toneGlide.next());
+
+        output[n] = processSample(input[n]);
+    }
+}
+
+} // namespace reference
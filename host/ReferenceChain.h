@@ -0,0 +1,136 @@
+#pragma once
+/**
+ * ReferenceChain.h - double-precision reference of the TubeScreamer chain (host only)
+ *
+ * The same circuit and signal flow as TubeScreamer::processOversampled() (clipper stages
+ * ClipWDFa/b/c, tone RC at twice the sample rate, the 2x decimator), built on the templated
+ * WDF classes in double and without any of the shortcuts the realtime chain takes:
+ *
+ *  - the diode pair is solved exactly (Newton on the implicit equation, to full double
+ *    precision) instead of through the omega4() approximations of Werner et al.;
+ *  - parameter glides move every sample and the impedances follow every sample, instead of
+ *    once per TubeScreamer::kSegmentSize;
+ *  - audio-rate modulation computes each drive and tone value directly, without tables;
+ *  - no idle mode and no denormal flushing.
+ *
+ * It is slow and meant for measuring how far the realtime chain is from the model (see
+ * host/ts_accuracy.cpp), not for rendering.
+ */
+
+#include <cstddef>
+
+#include <chowdsp_wdf/chowdsp_wdf.h>
+
+namespace reference {
+
+/** Antiparallel diode pair as a WDF root, solved exactly: (a - v) / R = 2 Is sinh(v / Vt). */
+class ExactDiodePair final : public chowdsp::wdft::RootWDF
+{
+  public:
+    template <typename Next>
+    ExactDiodePair(Next& n, double Is, double Vt = 25.85e-3) : Is(Is), Vt(Vt), portR(n.wdf.R), next(n.wdf)
+    {
+        n.connectToParent(this);
+    }
+
+    void calcImpedance() override { portR = next.R; }
+
+    void   incident(double x) noexcept { wdf.a = x; }
+    double reflected() noexcept;
+
+    chowdsp::wdft::WDFMembers<double> wdf;
+
+  private:
+    double Is;
+    double Vt;
+    double portR;
+
+    const chowdsp::wdft::WDFMembers<double>& next;
+};
+
+class Chain
+{
+  public:
+    Chain() = default;
+    Chain(const Chain&)            = delete; // the WDF trees hold references into themselves
+    Chain& operator=(const Chain&) = delete;
+
+    void prepare(double sampleRate);
+    void reset();
+
+    // Immediate changes
+    void setDrive(double potR);
+    void setTone(double R, double C);
+
+    // Linear glides over TubeScreamer::kParamRampMs, advanced every sample
+    void setDriveTarget(double potR);
+    void setToneTarget(double R);
+
+    // Ranges of a 0..1 modulation, mapped like TubeScreamer's tables (drive linear, tone log)
+    void setDriveModulationRange(double minDrive, double maxDrive);
+    void setToneModulationRange(double minR, double maxR);
+
+    double processSample(double x);
+
+    /** Like TubeScreamer::processBlock(); driveMod / toneMod may be nullptr. */
+    void process(const float* input, double* output, size_t numSamples, const float* driveMod = nullptr,
+                 const float* toneMod = nullptr);
+
+  private:
+    struct Glide
+    {
+        double current   = 0.0;
+        double target    = 0.0;
+        double step      = 0.0;
+        size_t remaining = 0;
+
+        void   set(double value);
+        void   setTarget(double value, size_t rampSamples);
+        double next();
+    };
+
+    void applyDrive(double potR);
+
+    static constexpr double kR6 = 5.0e3; // as in ClipWDFc
+
+    // ClipWDFa: input through Rin, C2 and RA + R5; the output is the voltage across R5
+    chowdsp::wdft::ResistorT<double>  rin { 1.0 };
+    chowdsp::wdft::ResistorT<double>  ra { 220.0 };
+    chowdsp::wdft::ResistorT<double>  r5 { 10000.0 };
+    chowdsp::wdft::CapacitorT<double> c2 { 1.0e-6 };
+    chowdsp::wdft::WDFSeriesT<double, decltype(ra), decltype(r5)>  a1 { ra, r5 };
+    chowdsp::wdft::WDFSeriesT<double, decltype(c2), decltype(a1)>  a2 { c2, a1 };
+    chowdsp::wdft::WDFSeriesT<double, decltype(rin), decltype(a2)> a3 { rin, a2 };
+    chowdsp::wdft::IdealVoltageSourceT<double, decltype(a3)>       vsA { a3 };
+
+    // ClipWDFb: R4-C3 high-pass, the output is the current through R4
+    chowdsp::wdft::ResistorT<double>  r4 { 4700.0 };
+    chowdsp::wdft::CapacitorT<double> c3 { 47.0e-9 };
+    chowdsp::wdft::WDFSeriesT<double, decltype(c3), decltype(r4)> b1 { c3, r4 };
+    chowdsp::wdft::IdealVoltageSourceT<double, decltype(b1)>      vsB { b1 };
+
+    // ClipWDFc: current source (R6 + drive pot) parallel to C4, into the diode pair
+    chowdsp::wdft::ResistiveCurrentSourceT<double> is {};
+    chowdsp::wdft::CapacitorT<double>              c4 { 51.0e-11 };
+    chowdsp::wdft::WDFParallelT<double, decltype(is), decltype(c4)> c1 { is, c4 };
+    ExactDiodePair                                                  dp { c1, 25e-9 };
+
+    // Tone: series RC at twice the sample rate, driven by the incident wave (see RCFilter)
+    chowdsp::wdft::ResistorT<double>  toneR { 1000.0 };
+    chowdsp::wdft::CapacitorT<double> toneC { 47e-9 };
+    chowdsp::wdft::WDFSeriesT<double, decltype(toneR), decltype(toneC)> tone { toneR, toneC };
+
+    double y1 = 0.0; // decimator history
+    double y2 = 0.0;
+
+    Glide  drive;
+    Glide  toneGlide;
+    size_t rampSamples = 1;
+
+    double driveModMin = 0.0;
+    double driveModMax = 500000.0;
+    double toneModMin  = 1000.0;
+    double toneModMax  = 20000.0;
+};
+
+} // namespace reference
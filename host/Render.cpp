@@ -0,0 +1,446 @@
+#include "Render.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <numeric>
+#include <sstream>
+
+#include "Denormals.h"
+#include "MappedWav.h"
+#include "SampleConvert.h"
+
+namespace render {
+
+namespace {
+
+constexpr float kGainRampMs = 5.0f; // as in main.cpp
+
+bool Fail(std::string* error, const std::string& what)
+{
+    if(error != nullptr)
+        *error = what;
+    return false;
+}
+
+double Seconds(std::chrono::steady_clock::duration d)
+{
+    return std::chrono::duration<double>(d).count();
+}
+
+// Zero-copy blocks where the reader can provide them; nullptr means fall back to Read()
+const float* ReadDirect(wav::Reader&, size_t&) { return nullptr; }
+const float* ReadDirect(wav::MappedReader& reader, size_t& frames) { return reader.ReadDirect(frames); }
+
+// The per-channel chains and their fixed-size buffers: Next() reads a chunk from a source
+// and returns it processed, interleaved. Memory does not depend on the file length.
+class ChunkProcessor
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    ChunkProcessor(const wav::Info& info, const Settings& settings, uint64_t startFrame)
+        : channels(info.channels), chunk(settings.chunkFrames), position(startFrame),
+          interleaved(chunk * channels), planar(chunk * channels), planes(channels)
+    {
+        for(size_t c = 0; c < channels; ++c)
+        {
+            chains.push_back(std::make_unique<ChannelRenderer>());
+            chains.back()->prepare(info.sampleRate, settings, startFrame);
+            planes[c] = planar.data() + c * chunk;
+        }
+    }
+
+    /** Processes up to maxFrames (at most one chunk); frames is 0 at the end of the source. */
+    template <typename Source>
+    const float* Next(Source& reader, size_t maxFrames, size_t& frames, Clock::duration& dsp)
+    {
+        frames              = (maxFrames < chunk) ? maxFrames : chunk;
+        const float* src    = ReadDirect(reader, frames);
+        if(src == nullptr)
+        {
+            frames = reader.Read(interleaved.data(), frames);
+            src    = interleaved.data();
+        }
+        if(frames == 0)
+            return nullptr;
+
+        // Mono needs no deinterleave: the chain reads the source block as is
+        const float* const* inputs = &src;
+        if(channels > 1)
+        {
+            convert::Deinterleave(src, planes.data(), channels, frames);
+            inputs = planes.data();
+        }
+
+        const auto t0 = Clock::now();
+        for(size_t c = 0; c < channels; ++c)
+            chains[c]->process(inputs[c], planes[c], frames, position);
+        dsp += Clock::now() - t0;
+        position += frames;
+
+        if(channels == 1)
+            return planes[0];
+        convert::Interleave(planes.data(), interleaved.data(), channels, frames);
+        return interleaved.data();
+    }
+
+  private:
+    size_t                                        channels;
+    size_t                                        chunk;
+    uint64_t                                      position;
+    std::vector<std::unique_ptr<ChannelRenderer>> chains;
+    std::vector<float>                            interleaved;
+    std::vector<float>                            planar;
+    std::vector<float*>                           planes;
+};
+
+template <typename Source>
+bool Stream(Source& reader, const std::string& out, const Settings& settings, Stats& stats, std::string* error)
+{
+    const wav::Info& info = reader.GetInfo();
+
+    wav::Writer writer;
+    if(!writer.Open(out, info.sampleRate, info.channels, settings.keepFormat ? info.format : settings.format))
+        return Fail(error, "cannot write " + out);
+
+    // Decaying tails stay fast on x86 even between the per-block flushes
+    denormals::ScopedNoDenormals noDenormals;
+
+    ChunkProcessor processor(info, settings, 0);
+    ChunkProcessor::Clock::duration dsp{};
+
+    stats          = Stats{};
+    stats.channels = info.channels;
+
+    size_t       frames;
+    const float* result;
+    while((result = processor.Next(reader, settings.chunkFrames, frames, dsp)) != nullptr)
+    {
+        if(!writer.Write(result, frames))
+            return Fail(error, "write failed: " + out);
+        stats.frames += frames;
+    }
+
+    if(!writer.Close())
+        return Fail(error, "write failed: " + out);
+
+    stats.audioSeconds = static_cast<double>(stats.frames) / info.sampleRate;
+    stats.dspSeconds   = Seconds(dsp);
+    return true;
+}
+
+bool OpenMapped(wav::MappedReader& reader, const std::string& in, const Settings& settings, std::string* error)
+{
+    return settings.rawChannels > 0 ? reader.OpenRaw(in, settings.rawSampleRate, settings.rawChannels, error)
+                                    : reader.Open(in, error);
+}
+
+} // namespace
+
+float Automation::ValueAt(double t) const
+{
+    if(points.empty())
+        return 0.0f;
+    if(t <= points.front().time)
+        return points.front().value;
+    for(size_t i = 1; i < points.size(); ++i)
+    {
+        if(t < points[i].time)
+        {
+            const Point& a = points[i - 1];
+            const Point& b = points[i];
+            return a.value + static_cast<float>((t - a.time) / (b.time - a.time)) * (b.value - a.value);
+        }
+    }
+    return points.back().value;
+}
+
+bool ParseAutomation(const std::string& spec, Automation& out, std::string* error)
+{
+    const size_t eq = spec.find('=');
+    if(eq == std::string::npos)
+        return Fail(error, "automation '" + spec + "': expected param=time:value,...");
+
+    const std::string name = spec.substr(0, eq);
+    if(name == "drive") out.param = Param::Drive;
+    else if(name == "tone") out.param = Param::Tone;
+    else if(name == "pre") out.param = Param::PreGain;
+    else if(name == "post") out.param = Param::PostGain;
+    else return Fail(error, "automation: unknown param '" + name + "'");
+
+    out.points.clear();
+    std::istringstream list(spec.substr(eq + 1));
+    std::string        item;
+    while(std::getline(list, item, ','))
+    {
+        char*        end  = nullptr;
+        const double time = std::strtod(item.c_str(), &end);
+        if(*end != ':')
+            return Fail(error, "automation: bad point '" + item + "'");
+        const char* v     = end + 1;
+        const float value = std::strtof(v, &end);
+        if(end == v || *end != '\0' || (!out.points.empty() && time < out.points.back().time))
+            return Fail(error, "automation: bad point '" + item + "' (times must not decrease)");
+        out.points.push_back({ time, value });
+    }
+    if(out.points.empty())
+        return Fail(error, "automation '" + spec + "' has no points");
+    return true;
+}
+
+// ---------------- ChannelRenderer ----------------
+
+void ChannelRenderer::prepare(float fs, const Settings& s, uint64_t startFrame)
+{
+    settings   = &s;
+    sampleRate = fs;
+
+    const double t = static_cast<double>(startFrame) / fs;
+    ts.prepare(fs);
+    ts.setGain(paramAt(Param::Drive, s.drive, t));
+    ts.setTone(paramAt(Param::Tone, s.tone, t), s.toneC);
+    ts.reset();
+
+    preGain.prepare(fs, kGainRampMs);
+    postGain.prepare(fs, kGainRampMs);
+    preGain.setCurrentAndTarget(paramAt(Param::PreGain, s.preGain, t));
+    postGain.setCurrentAndTarget(paramAt(Param::PostGain, s.postGain, t));
+
+    scratch.assign(s.blockSize, 0.0f);
+}
+
+double ChannelRenderer::getLongestTimeConstant() const
+{
+    // Automation sampled per block keeps the glides chasing their targets, which makes them
+    // behave like one-pole lags of about their ramp time
+    const double chain  = ts.getLongestTimeConstant();
+    const double glides = settings->automation.empty() ? 0.0 : 0.001 * std::max(TubeScreamer::kParamRampMs, kGainRampMs);
+    return std::max(chain, glides);
+}
+
+float ChannelRenderer::paramAt(Param p, float fallback, double t) const
+{
+    for(const Automation& a : settings->automation)
+        if(a.param == p)
+            return a.ValueAt(t);
+    return fallback;
+}
+
+void ChannelRenderer::process(const float* input, float* output, size_t frames, uint64_t startFrame)
+{
+    const Settings& s = *settings;
+    for(size_t n = 0; n < frames; n += s.blockSize)
+    {
+        const size_t len = (frames - n < s.blockSize) ? frames - n : s.blockSize;
+
+        // Automation is sampled once per block; TubeScreamer and the gain smoothers glide in between
+        if(!s.automation.empty())
+        {
+            const double t = static_cast<double>(startFrame + n) / sampleRate;
+            ts.setGainTarget(paramAt(Param::Drive, s.drive, t));
+            ts.setToneTarget(paramAt(Param::Tone, s.tone, t));
+            preGain.setTarget(paramAt(Param::PreGain, s.preGain, t));
+            postGain.setTarget(paramAt(Param::PostGain, s.postGain, t));
+        }
+
+        for(size_t k = 0; k < len; ++k)
+            scratch[k] = input[n + k] * preGain.getNext();
+
+        ts.processBlock(scratch.data(), scratch.data(), len);
+
+        for(size_t k = 0; k < len; ++k)
+            output[n + k] = scratch[k] * postGain.getNext();
+    }
+}
+
+// ---------------- RenderFile ----------------
+
+bool RenderFile(const std::string& in, const std::string& out, const Settings& settings, Stats& stats,
+                std::string* error)
+{
+    using Clock      = std::chrono::steady_clock;
+    const auto start = Clock::now();
+
+    bool ok;
+    if(settings.mapInput || settings.rawChannels > 0)
+    {
+        wav::MappedReader reader;
+        ok = OpenMapped(reader, in, settings, error) && Stream(reader, out, settings, stats, error);
+    }
+    else
+    {
+        wav::Reader reader;
+        ok = reader.Open(in, error) && Stream(reader, out, settings, stats, error);
+    }
+
+    stats.wallSeconds = Seconds(Clock::now() - start);
+    return ok;
+}
+
+// ---------------- RenderBatch ----------------
+
+void RenderBatch(std::vector<BatchItem>& items, const Settings& settings, const tasks::PoolOptions& pool,
+                 BatchStats& stats)
+{
+    using Clock      = std::chrono::steady_clock;
+    const auto start = Clock::now();
+
+    // Longest first (by file size) so that the stragglers at the end are short ones
+    std::vector<uintmax_t> sizes(items.size());
+    std::vector<size_t>    order(items.size());
+    for(size_t i = 0; i < items.size(); ++i)
+    {
+        std::error_code ec;
+        sizes[i] = std::filesystem::file_size(items[i].in, ec);
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sizes[a] > sizes[b]; });
+
+    tasks::RunTasks(order.size(), pool, [&](size_t task, size_t worker) {
+        BatchItem& item = items[order[task]];
+        item.worker     = worker;
+        item.ok         = RenderFile(item.in, item.out, settings, item.stats, &item.error);
+    });
+
+    stats         = BatchStats{};
+    stats.files   = items.size();
+    stats.threads = tasks::WorkerCount(pool, items.size());
+    for(const BatchItem& item : items)
+    {
+        stats.failed += item.ok ? 0 : 1;
+        stats.audioSeconds += item.ok ? item.stats.audioSeconds : 0.0;
+    }
+    stats.wallSeconds = Seconds(Clock::now() - start);
+}
+
+// ---------------- RenderSegmented ----------------
+
+uint64_t PrerollFrames(float sampleRate, const Settings& settings, double tolerance, double* timeConstant)
+{
+    auto chain = std::make_unique<ChannelRenderer>();
+    chain->prepare(sampleRate, settings);
+    const double tau = chain->getLongestTimeConstant();
+    if(timeConstant != nullptr)
+        *timeConstant = tau;
+    return static_cast<uint64_t>(std::ceil(tau * std::log(1.0 / tolerance) * sampleRate));
+}
+
+bool RenderSegmented(const std::string& in, const std::string& out, const Settings& settings,
+                     const SegmentOptions& options, Stats& stats, SegmentReport& report, std::string* error)
+{
+    using Clock      = std::chrono::steady_clock;
+    const auto start = Clock::now();
+
+    wav::MappedReader probe;
+    if(!OpenMapped(probe, in, settings, error))
+        return false;
+    const wav::Info info = probe.GetInfo();
+    probe.Close();
+
+    wav::MappedWriter writer;
+    if(!writer.Open(out, info.sampleRate, info.channels, settings.keepFormat ? info.format : settings.format,
+                    info.frames, error))
+        return false;
+
+    // Starts on the serial chunk grid (which also keeps TubeScreamer's coefficient segments aligned)
+    const uint64_t grid    = std::lcm<uint64_t>(settings.chunkFrames, TubeScreamer::kSegmentSize);
+    auto           roundUp = [grid](uint64_t x) { return (x + grid - 1) / grid * grid; };
+    const size_t   workers = tasks::WorkerCount(options.pool, 0);
+
+    report           = SegmentReport{};
+    uint64_t preroll = PrerollFrames(info.sampleRate, settings, options.tolerance, &report.timeConstant);
+    if(options.prerollSeconds >= 0.0)
+        preroll = static_cast<uint64_t>(options.prerollSeconds * info.sampleRate);
+    preroll = roundUp(preroll);
+
+    uint64_t length = (options.segmentSeconds > 0.0)
+                          ? static_cast<uint64_t>(options.segmentSeconds * info.sampleRate)
+                          : info.frames / (4 * workers);
+    // Keep the pre-roll overhead small whatever the split
+    length = roundUp(std::max<uint64_t>(length, 8 * preroll));
+
+    report.segmentFrames = length;
+    report.prerollFrames = preroll;
+    report.segments      = static_cast<size_t>((info.frames + length - 1) / length);
+
+    std::vector<std::string>                     errors(report.segments);
+    std::vector<ChunkProcessor::Clock::duration> dsp(report.segments);
+
+    tasks::RunTasks(report.segments, options.pool, [&](size_t segment, size_t) {
+        denormals::ScopedNoDenormals noDenormals;
+
+        const uint64_t from = segment * length;
+        const uint64_t to   = std::min(info.frames, from + length);
+        const uint64_t warm = (from > preroll) ? from - preroll : 0;
+
+        wav::MappedReader reader;
+        if(!OpenMapped(reader, in, settings, &errors[segment]))
+            return;
+        reader.Seek(warm);
+
+        ChunkProcessor processor(info, settings, warm);
+        size_t         frames;
+        for(uint64_t pos = warm; pos < to; pos += frames)
+        {
+            const float* result = processor.Next(reader, static_cast<size_t>(to - pos), frames, dsp[segment]);
+            if(result == nullptr)
+                break;
+            if(pos >= from && !writer.Write(pos, result, frames))
+            {
+                errors[segment] = "write failed: " + out;
+                return;
+            }
+        }
+    });
+
+    if(!writer.Close())
+        return Fail(error, "write failed: " + out);
+    for(const std::string& e : errors)
+        if(!e.empty())
+            return Fail(error, e);
+
+    stats              = Stats{};
+    stats.frames       = info.frames;
+    stats.channels     = info.channels;
+    stats.audioSeconds = static_cast<double>(info.frames) / info.sampleRate;
+    for(const ChunkProcessor::Clock::duration& d : dsp)
+        stats.dspSeconds += Seconds(d);
+    stats.wallSeconds = Seconds(Clock::now() - start);
+    return true;
+}
+
+bool CompareFiles(const std::string& a, const std::string& b, Deviation& deviation, std::string* error)
+{
+    wav::Reader ra;
+    wav::Reader rb;
+    if(!ra.Open(a, error) || !rb.Open(b, error))
+        return false;
+    const size_t channels = ra.GetInfo().channels;
+    if(rb.GetInfo().channels != channels || rb.GetInfo().frames != ra.GetInfo().frames)
+        return Fail(error, a + " and " + b + " differ in length or channel count");
+
+    constexpr size_t   kChunk = 4096;
+    std::vector<float> xa(kChunk * channels);
+    std::vector<float> xb(kChunk * channels);
+    deviation = Deviation{};
+
+    uint64_t position = 0;
+    size_t   frames;
+    while((frames = ra.Read(xa.data(), kChunk)) > 0 && rb.Read(xb.data(), frames) == frames)
+    {
+        for(size_t i = 0; i < frames * channels; ++i)
+        {
+            const double d = std::fabs(static_cast<double>(xa[i]) - xb[i]);
+            if(d > deviation.maxAbs)
+                deviation = { d, position + i / channels, i % channels };
+        }
+        position += frames;
+    }
+    return true;
+}
+
+} // namespace render
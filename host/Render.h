@@ -0,0 +1,190 @@
+#pragma once
+/**
+ * Render.h - offline rendering of audio files through the pedal model (host only)
+ *
+ * ChannelRenderer is the per-channel chain the firmware runs (pre-gain, TubeScreamer,
+ * post-gain) driven by Settings and automation instead of pots. RenderFile() streams a WAV
+ * through one ChannelRenderer per channel in fixed-size chunks, so memory stays constant
+ * whatever the file length. With Settings::mapInput the input is memory-mapped instead
+ * (host/MappedWav.h) and float32 blocks go to the chains straight from the mapping.
+ * RenderBatch() renders many files in parallel on a work-stealing pool (host/TaskPool.h);
+ * RenderSegmented() splits one long file into segments rendered in parallel, each warmed up
+ * on a pre-roll long enough for the chain to forget its initial state.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "TubeScreamer.h"
+#include "ParamSmoother.h"
+#include "TaskPool.h"
+#include "WavFile.h"
+
+namespace render {
+
+enum class Param
+{
+    Drive,    // drive pot resistance in ohms
+    Tone,     // tone resistor in ohms
+    PreGain,
+    PostGain,
+};
+
+/** Breakpoints (seconds, value) with linear interpolation; held before the first and after the last. */
+struct Automation
+{
+    struct Point
+    {
+        double time;
+        float  value;
+    };
+
+    Param              param;
+    std::vector<Point> points;
+
+    float ValueAt(double t) const;
+};
+
+/** Parses "drive=0:10,2:250000" (param=time:value,...); params: drive, tone, pre, post. */
+bool ParseAutomation(const std::string& spec, Automation& out, std::string* error = nullptr);
+
+struct Settings
+{
+    float drive    = 250000.0f;
+    float tone     = 10000.0f;
+    float toneC    = 47e-9f;
+    float preGain  = 1.0f;
+    float postGain = 1.0f;
+
+    std::vector<Automation> automation;
+
+    size_t blockSize   = 64;   // frames per TubeScreamer::processBlock() call
+    size_t chunkFrames = 4096; // frames per file read / write
+
+    bool   mapInput      = false;    // read through wav::MappedReader instead of buffered fread
+    size_t rawChannels   = 0;        // > 0: input is headerless float32 (implies mapInput)
+    float  rawSampleRate = 48000.0f; // sample rate of raw input
+
+    bool        keepFormat = true; // write the input's sample format
+    wav::Format format     = wav::Format::Float32;
+};
+
+struct Stats
+{
+    uint64_t frames       = 0;
+    size_t   channels     = 0;
+    double   audioSeconds = 0.0;
+    double   wallSeconds  = 0.0; // whole render including file I/O
+    double   dspSeconds   = 0.0; // ChannelRenderer::process() only
+
+    double RealtimeFactor() const { return wallSeconds > 0.0 ? audioSeconds / wallSeconds : 0.0; }
+    double DspRealtimeFactor() const { return dspSeconds > 0.0 ? audioSeconds / dspSeconds : 0.0; }
+};
+
+class ChannelRenderer
+{
+  public:
+    ChannelRenderer() = default;
+    ChannelRenderer(const ChannelRenderer&) = delete; // the WDF trees hold pointers into themselves
+    ChannelRenderer& operator=(const ChannelRenderer&) = delete;
+
+    /** startFrame: where processing will start, for the initial automation values. */
+    void prepare(float sampleRate, const Settings& settings, uint64_t startFrame = 0);
+
+    /** Longest time constant of the chain state in seconds, including the glides under automation. */
+    double getLongestTimeConstant() const;
+
+    /** Processes frames starting at absolute frame position startFrame (for automation). */
+    void process(const float* input, float* output, size_t frames, uint64_t startFrame);
+
+  private:
+    float paramAt(Param p, float fallback, double t) const;
+
+    TubeScreamer       ts;
+    ExpSmoother        preGain;
+    ExpSmoother        postGain;
+    const Settings*    settings   = nullptr;
+    float              sampleRate = 48000.0f;
+    std::vector<float> scratch;
+};
+
+/** Streams in through the model into out; fills stats. */
+bool RenderFile(const std::string& in, const std::string& out, const Settings& settings, Stats& stats,
+                std::string* error = nullptr);
+
+/** One file of a batch; ok, error, stats and worker are filled in by RenderBatch(). */
+struct BatchItem
+{
+    std::string in;
+    std::string out;
+
+    bool        ok = false;
+    std::string error;
+    Stats       stats;
+    size_t      worker = 0;
+};
+
+struct BatchStats
+{
+    size_t files        = 0;
+    size_t failed       = 0;
+    size_t threads      = 0;
+    double audioSeconds = 0.0;
+    double wallSeconds  = 0.0;
+
+    double RealtimeFactor() const { return wallSeconds > 0.0 ? audioSeconds / wallSeconds : 0.0; }
+};
+
+/**
+ * Renders every item with RenderFile(), largest input first, on a work-stealing pool. Each
+ * file gets its own freshly prepared chains, so the output does not depend on the thread count.
+ */
+void RenderBatch(std::vector<BatchItem>& items, const Settings& settings, const tasks::PoolOptions& pool,
+                 BatchStats& stats);
+
+struct SegmentOptions
+{
+    tasks::PoolOptions pool;
+    double segmentSeconds = 0.0;  // 0: about four segments per worker
+    double prerollSeconds = -1.0; // < 0: derived from the slowest time constant of the chain
+    double tolerance      = 1e-6; // residue of the initial state allowed at a segment start
+};
+
+struct SegmentReport
+{
+    size_t   segments      = 0;
+    uint64_t segmentFrames = 0;
+    uint64_t prerollFrames = 0;
+    double   timeConstant  = 0.0; // seconds, the slowest one of the chain
+};
+
+/**
+ * Pre-roll for a chain to forget its initial state down to tolerance: the slowest time
+ * constant (ChannelRenderer::getLongestTimeConstant()) times ln(1 / tolerance).
+ */
+uint64_t PrerollFrames(float sampleRate, const Settings& settings, double tolerance, double* timeConstant = nullptr);
+
+/**
+ * Renders one file as independent segments in parallel. Each segment starts a pre-roll early
+ * on fresh chains and discards the pre-roll output. Segment and pre-roll starts fall on the
+ * chunk grid of a serial render, so blocks, automation sampling and coefficient segments
+ * line up with RenderFile() and only the decayed initial state differs. The input is
+ * memory-mapped (Settings::rawChannels is honoured), and so is the output.
+ */
+bool RenderSegmented(const std::string& in, const std::string& out, const Settings& settings,
+                     const SegmentOptions& options, Stats& stats, SegmentReport& report,
+                     std::string* error = nullptr);
+
+struct Deviation
+{
+    double   maxAbs = 0.0;
+    uint64_t frame  = 0; // where maxAbs occurs
+    size_t   channel = 0;
+};
+
+/** Compares two files of the same shape sample by sample (as floats). */
+bool CompareFiles(const std::string& a, const std::string& b, Deviation& deviation, std::string* error = nullptr);
+
+} // namespace render
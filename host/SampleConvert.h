@@ -0,0 +1,105 @@
+#pragma once
+/**
+ * SampleConvert.h - PCM <-> float conversion for the host tools
+ *
+ * Plain loops over restrict-qualified buffers with no branches in the body, so GCC and Clang
+ * vectorize them at -O3 (SSE/AVX on x86-64, NEON on ARM64) without per-ISA intrinsics.
+ * Samples are little-endian as stored in WAV files; the host is assumed little-endian too.
+ * Float -> int conversions clamp to -1..1 and round to nearest (half away from zero).
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace convert {
+
+// Comparisons rather than std::fmin/fmax, whose NaN rules keep GCC from vectorizing
+inline float Clamp(float x)
+{
+    x = (x < -1.0f) ? -1.0f : x;
+    return (x > 1.0f) ? 1.0f : x;
+}
+
+/** Round half away from zero with a truncating conversion; unlike lrintf() this vectorizes. */
+inline int32_t Round(float x)
+{
+    return static_cast<int32_t>(x + (x < 0.0f ? -0.5f : 0.5f));
+}
+
+inline void Int16ToFloat(const int16_t* __restrict in, float* __restrict out, size_t n)
+{
+    for(size_t i = 0; i < n; ++i)
+        out[i] = static_cast<float>(in[i]) * (1.0f / 32768.0f);
+}
+
+/** in holds 3 bytes per sample */
+inline void Int24ToFloat(const uint8_t* __restrict in, float* __restrict out, size_t n)
+{
+    for(size_t i = 0; i < n; ++i)
+    {
+        const int32_t v = static_cast<int32_t>((static_cast<uint32_t>(in[3 * i]) << 8)
+                                               | (static_cast<uint32_t>(in[3 * i + 1]) << 16)
+                                               | (static_cast<uint32_t>(in[3 * i + 2]) << 24));
+        out[i] = static_cast<float>(v) * (1.0f / 2147483648.0f);
+    }
+}
+
+inline void Int32ToFloat(const int32_t* __restrict in, float* __restrict out, size_t n)
+{
+    for(size_t i = 0; i < n; ++i)
+        out[i] = static_cast<float>(in[i]) * (1.0f / 2147483648.0f);
+}
+
+inline void FloatToInt16(const float* __restrict in, int16_t* __restrict out, size_t n)
+{
+    for(size_t i = 0; i < n; ++i)
+        out[i] = static_cast<int16_t>(Round(Clamp(in[i]) * 32767.0f));
+}
+
+/** out receives 3 bytes per sample */
+inline void FloatToInt24(const float* __restrict in, uint8_t* __restrict out, size_t n)
+{
+    for(size_t i = 0; i < n; ++i)
+    {
+        const int32_t v = Round(Clamp(in[i]) * 8388607.0f);
+        out[3 * i]     = static_cast<uint8_t>(v);
+        out[3 * i + 1] = static_cast<uint8_t>(v >> 8);
+        out[3 * i + 2] = static_cast<uint8_t>(v >> 16);
+    }
+}
+
+inline void FloatToInt32(const float* __restrict in, int32_t* __restrict out, size_t n)
+{
+    // 2^31 - 1 is not representable in float: cap at the largest float below 2^31
+    constexpr float kMax = 2147483520.0f;
+    for(size_t i = 0; i < n; ++i)
+    {
+        const float v = Clamp(in[i]) * 2147483648.0f;
+        out[i]        = Round(v < kMax ? v : kMax);
+    }
+}
+
+/** Splits interleaved frames into one buffer per channel. */
+inline void Deinterleave(const float* __restrict in, float* const* out, size_t channels, size_t frames)
+{
+    for(size_t c = 0; c < channels; ++c)
+    {
+        float* __restrict dst = out[c];
+        for(size_t f = 0; f < frames; ++f)
+            dst[f] = in[f * channels + c];
+    }
+}
+
+inline void Interleave(const float* const* in, float* __restrict out, size_t channels, size_t frames)
+{
+    for(size_t c = 0; c < channels; ++c)
+    {
+        const float* __restrict src = in[c];
+        for(size_t f = 0; f < frames; ++f)
+            out[f * channels + c] = src[f];
+    }
+}
+
+} // namespace convert
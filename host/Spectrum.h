@@ -0,0 +1,95 @@
+#pragma once
+/**
+ * Spectrum.h - FFT and averaged power spectra for the host analysis tools
+ *
+ * A plain radix-2 FFT: the tools analyse a few seconds of audio, so clarity wins over speed.
+ */
+
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace spectrum {
+
+/** In-place forward FFT; the size must be a power of two. */
+inline void FFT(std::vector<std::complex<double>>& x)
+{
+    const size_t n = x.size();
+    for(size_t i = 1, j = 0; i < n; ++i)
+    {
+        size_t bit = n >> 1;
+        for(; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if(i < j)
+            std::swap(x[i], x[j]);
+    }
+
+    const double pi = 3.14159265358979323846;
+    for(size_t len = 2; len <= n; len <<= 1)
+    {
+        const std::complex<double> w = std::polar(1.0, -2.0 * pi / static_cast<double>(len));
+        for(size_t i = 0; i < n; i += len)
+        {
+            std::complex<double> wk = 1.0;
+            for(size_t k = 0; k < len / 2; ++k)
+            {
+                const std::complex<double> a = x[i + k];
+                const std::complex<double> b = x[i + k + len / 2] * wk;
+                x[i + k]                     = a + b;
+                x[i + k + len / 2]           = a - b;
+                wk *= w;
+            }
+        }
+    }
+}
+
+/** Power spectrum of one rectangular frame (for periodic signals analysed over whole periods). */
+template <typename Sample>
+std::vector<double> FramePower(const Sample* x, size_t fftSize)
+{
+    std::vector<std::complex<double>> frame(fftSize);
+    for(size_t n = 0; n < fftSize; ++n)
+        frame[n] = static_cast<double>(x[n]);
+    FFT(frame);
+
+    std::vector<double> power(fftSize / 2 + 1);
+    for(size_t k = 0; k < power.size(); ++k)
+        power[k] = std::norm(frame[k]);
+    return power;
+}
+
+/**
+ * Welch power spectrum: Hann-windowed frames of fftSize with 50 % overlap, averaged.
+ * Returns fftSize / 2 + 1 bins; bin k is at k * sampleRate / fftSize.
+ */
+template <typename Sample>
+std::vector<double> PowerSpectrum(const Sample* x, size_t samples, size_t fftSize)
+{
+    const double pi = 3.14159265358979323846;
+
+    std::vector<double> window(fftSize);
+    for(size_t n = 0; n < fftSize; ++n)
+        window[n] = 0.5 - 0.5 * std::cos(2.0 * pi * static_cast<double>(n) / static_cast<double>(fftSize));
+
+    std::vector<double>               power(fftSize / 2 + 1, 0.0);
+    std::vector<std::complex<double>> frame(fftSize);
+    size_t                            frames = 0;
+    for(size_t start = 0; start + fftSize <= samples; start += fftSize / 2, ++frames)
+    {
+        for(size_t n = 0; n < fftSize; ++n)
+            frame[n] = static_cast<double>(x[start + n]) * window[n];
+        FFT(frame);
+        for(size_t k = 0; k < power.size(); ++k)
+            power[k] += std::norm(frame[k]);
+    }
+
+    if(frames > 0)
+        for(double& p : power)
+            p /= static_cast<double>(frames);
+    return power;
+}
+
+} // namespace spectrum
@@ -0,0 +1,132 @@
+#include "TaskPool.h"
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace tasks {
+
+namespace {
+
+// One lock per queue: tasks are whole files or segments, so contention is negligible
+struct Queue
+{
+    std::mutex         lock;
+    std::deque<size_t> items;
+
+    bool PopFront(size_t& out)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if(items.empty())
+            return false;
+        out = items.front();
+        items.pop_front();
+        return true;
+    }
+
+    bool PopBack(size_t& out)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if(items.empty())
+            return false;
+        out = items.back();
+        items.pop_back();
+        return true;
+    }
+};
+
+void PinToCpu(std::thread& thread, size_t cpu)
+{
+#ifdef __linux__
+    const size_t cpus = std::thread::hardware_concurrency();
+    cpu_set_t    set;
+    CPU_ZERO(&set);
+    CPU_SET(static_cast<int>(cpus > 0 ? cpu % cpus : 0), &set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+    (void)thread;
+    (void)cpu;
+#endif
+}
+
+} // namespace
+
+size_t WorkerCount(const PoolOptions& options, size_t count)
+{
+    size_t n = options.threads;
+    if(n == 0)
+        n = std::thread::hardware_concurrency();
+    if(n == 0)
+        n = 1;
+    return (count > 0 && count < n) ? count : n;
+}
+
+void RunTasks(size_t count, const PoolOptions& options, const std::function<void(size_t task, size_t worker)>& task)
+{
+    const size_t workers = WorkerCount(options, count);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    for(size_t w = 0; w < workers; ++w)
+        queues.push_back(std::make_unique<Queue>());
+    for(size_t i = 0; i < count; ++i)
+        queues[i % workers]->items.push_back(i);
+
+    auto work = [&](size_t self) {
+        size_t i;
+        while(true)
+        {
+            if(queues[self]->PopFront(i))
+            {
+                task(i, self);
+                continue;
+            }
+            // Out of own work: steal the last (shortest) task of the next non-empty queue.
+            // Queues only shrink, so one empty sweep means everything has been taken.
+            bool stolen = false;
+            for(size_t k = 1; k < workers && !stolen; ++k)
+                stolen = queues[(self + k) % workers]->PopBack(i);
+            if(!stolen)
+                return;
+            task(i, self);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(size_t w = 1; w < workers; ++w)
+    {
+        threads.emplace_back(work, w);
+        if(options.pin)
+            PinToCpu(threads.back(), w);
+    }
+
+    // The calling thread is worker 0
+    if(options.pin && workers > 1)
+    {
+#ifdef __linux__
+        cpu_set_t set;
+        cpu_set_t saved;
+        CPU_ZERO(&set);
+        CPU_SET(0, &set);
+        pthread_getaffinity_np(pthread_self(), sizeof(saved), &saved);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        work(0);
+        pthread_setaffinity_np(pthread_self(), sizeof(saved), &saved);
+#else
+        work(0);
+#endif
+    }
+    else
+        work(0);
+
+    for(std::thread& t : threads)
+        t.join();
+}
+
+} // namespace tasks
@@ -0,0 +1,31 @@
+#pragma once
+/**
+ * TaskPool.h - work-stealing parallel loop for the host tools
+ *
+ * RunTasks() runs task(i, worker) for every i in 0..count-1 on a set of worker threads and
+ * returns when all are done. Tasks are dealt round-robin in the given order, so callers
+ * put the longest first; each worker takes its own tasks front to back and, once out,
+ * steals from the back of the others. Files of very different lengths thus end up
+ * balanced without any cost model beyond the initial order.
+ *
+ * Which worker runs a task depends on timing: tasks must not share mutable state if the
+ * results are to be the same for any thread count.
+ */
+
+#include <cstddef>
+#include <functional>
+
+namespace tasks {
+
+struct PoolOptions
+{
+    size_t threads = 0;    // 0: one per hardware thread
+    bool   pin     = false; // pin worker n to CPU n (Linux; ignored elsewhere)
+};
+
+/** Number of workers RunTasks() would start for options and count tasks (0: not limited by the count). */
+size_t WorkerCount(const PoolOptions& options, size_t count);
+
+void RunTasks(size_t count, const PoolOptions& options, const std::function<void(size_t task, size_t worker)>& task);
+
+} // namespace tasks
@@ -0,0 +1,74 @@
+#pragma once
+/**
+ * TelemetryLog.h - drains a telemetry::Ring (Telemetry.h) on a background thread (host only)
+ *
+ * The host counterpart of the firmware's main loop drain: the audio thread records events,
+ * this thread wakes every period, formats whatever is queued and writes it to a FILE (stdout
+ * or a log file). Stop() (or the destructor) drains once more, so nothing recorded before it
+ * is lost.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include "Telemetry.h"
+
+namespace telemetry {
+
+template <typename RingT>
+class LogThread
+{
+  public:
+    LogThread(RingT& ring, FILE* out, std::chrono::milliseconds period = std::chrono::milliseconds(10))
+        : ring_(ring), out_(out), period_(period), thread_([this]() { Run(); })
+    {
+    }
+
+    ~LogThread() { Stop(); }
+
+    LogThread(const LogThread&)            = delete;
+    LogThread& operator=(const LogThread&) = delete;
+
+    void Stop()
+    {
+        if(!thread_.joinable())
+            return;
+        running_.store(false, std::memory_order_relaxed);
+        thread_.join();
+        DrainOnce();
+        std::fflush(out_);
+    }
+
+    /** Events written so far (read it after Stop()). */
+    size_t Events() const { return events_; }
+
+  private:
+    void Run()
+    {
+        while(running_.load(std::memory_order_relaxed))
+        {
+            DrainOnce();
+            std::this_thread::sleep_for(period_);
+        }
+    }
+
+    void DrainOnce()
+    {
+        events_ += ring_.Drain([this](const Event& e) {
+            char line[96];
+            Format(e, line, sizeof(line));
+            std::fprintf(out_, "%s\n", line);
+        });
+    }
+
+    RingT&                    ring_;
+    FILE*                     out_;
+    std::chrono::milliseconds period_;
+    std::atomic<bool>         running_ { true };
+    size_t                    events_ = 0;
+    std::thread               thread_; // last: starts once everything above is initialized
+};
+
+} // namespace telemetry
@@ -0,0 +1,72 @@
+#pragma once
+/**
+ * TestSignals.h - deterministic test signals for the host benchmarks and test harnesses
+ *
+ * Everything is generated from a seed, so two runs (or two builds) see the same samples.
+ */
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace signals {
+
+constexpr double kPi = 3.14159265358979323846;
+
+/** Plucked notes with decaying harmonics and a little noise, peaks around -6 dBFS. */
+inline std::vector<float> GuitarDI(float sampleRate, size_t samples, uint32_t seed = 1)
+{
+    const float        notes[] = { 82.41f, 110.0f, 146.83f, 196.0f, 246.94f, 329.63f };
+    std::vector<float> x(samples, 0.0f);
+    std::mt19937       rng(seed);
+    std::uniform_real_distribution<float> noise(-1e-3f, 1e-3f);
+
+    const size_t pluck = static_cast<size_t>(sampleRate / 6.0f); // six notes per second
+    for (size_t n = 0; n < samples; ++n)
+    {
+        const float f   = notes[(n / pluck + seed) % 6];
+        const float t   = static_cast<float>(n % pluck) / sampleRate;
+        float       sum = 0.0f;
+        for (int h = 1; h <= 6; ++h)
+            sum += std::sin(2.0f * static_cast<float>(kPi) * f * h * t) * std::exp(-t * 3.0f * h) / h;
+        x[n] = 0.3f * sum + noise(rng);
+    }
+    return x;
+}
+
+inline std::vector<float> Sine(float sampleRate, size_t samples, double freq, float amplitude)
+{
+    std::vector<float> x(samples);
+    for (size_t n = 0; n < samples; ++n)
+        x[n] = amplitude * static_cast<float>(std::sin(2.0 * kPi * freq * static_cast<double>(n) / sampleRate));
+    return x;
+}
+
+/** Exponential sine sweep from f0 to f1 over the whole length. */
+inline std::vector<float> Sweep(float sampleRate, size_t samples, double f0, double f1, float amplitude)
+{
+    std::vector<float> x(samples);
+    const double       duration = static_cast<double>(samples) / sampleRate;
+    const double       k        = std::log(f1 / f0);
+    for (size_t n = 0; n < samples; ++n)
+    {
+        const double t = static_cast<double>(n) / sampleRate;
+        x[n] = amplitude * static_cast<float>(std::sin(2.0 * kPi * f0 * duration / k * (std::exp(t / duration * k) - 1.0)));
+    }
+    return x;
+}
+
+/** Gaussian white noise at the given RMS level. */
+inline std::vector<float> Noise(size_t samples, float rms, uint32_t seed = 1)
+{
+    std::vector<float>              x(samples);
+    std::mt19937                    rng(seed);
+    std::normal_distribution<float> dist(0.0f, rms);
+    for (float& v : x)
+        v = dist(rng);
+    return x;
+}
+
+} // namespace signals
@@ -0,0 +1,302 @@
+#include "WavFile.h"
+
+#include <cstring>
+
+#include "SampleConvert.h"
+
+namespace wav {
+
+namespace {
+
+constexpr uint16_t kFormatPcm        = 1;
+constexpr uint16_t kFormatFloat      = 3;
+constexpr uint16_t kFormatExtensible = 0xFFFE;
+
+uint32_t ReadU32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24); }
+uint64_t ReadU64(const uint8_t* p) { return ReadU32(p) | (static_cast<uint64_t>(ReadU32(p + 4)) << 32); }
+uint16_t ReadU16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+
+void PutU64(uint8_t* p, uint64_t x)
+{
+    for(int i = 0; i < 8; ++i)
+        p[i] = static_cast<uint8_t>(x >> (8 * i));
+}
+
+void PutU32(uint8_t* p, uint32_t x)
+{
+    for(int i = 0; i < 4; ++i)
+        p[i] = static_cast<uint8_t>(x >> (8 * i));
+}
+
+void PutU16(uint8_t* p, uint16_t x)
+{
+    p[0] = static_cast<uint8_t>(x);
+    p[1] = static_cast<uint8_t>(x >> 8);
+}
+
+bool Fail(std::string* error, const std::string& what)
+{
+    if(error != nullptr)
+        *error = what;
+    return false;
+}
+
+void ToFloat(const uint8_t* in, float* out, size_t n, Format format)
+{
+    switch(format)
+    {
+        case Format::Pcm16: convert::Int16ToFloat(reinterpret_cast<const int16_t*>(in), out, n); break;
+        case Format::Pcm24: convert::Int24ToFloat(in, out, n); break;
+        case Format::Pcm32: convert::Int32ToFloat(reinterpret_cast<const int32_t*>(in), out, n); break;
+        case Format::Float32: std::memcpy(out, in, n * sizeof(float)); break;
+    }
+}
+
+void FromFloat(const float* in, uint8_t* out, size_t n, Format format)
+{
+    switch(format)
+    {
+        case Format::Pcm16: convert::FloatToInt16(in, reinterpret_cast<int16_t*>(out), n); break;
+        case Format::Pcm24: convert::FloatToInt24(in, out, n); break;
+        case Format::Pcm32: convert::FloatToInt32(in, reinterpret_cast<int32_t*>(out), n); break;
+        case Format::Float32: std::memcpy(out, in, n * sizeof(float)); break;
+    }
+}
+
+} // namespace
+
+size_t BytesPerSample(Format format)
+{
+    switch(format)
+    {
+        case Format::Pcm16: return 2;
+        case Format::Pcm24: return 3;
+        case Format::Pcm32:
+        case Format::Float32:
+        default: return 4;
+    }
+}
+
+bool ParseFormat(const std::string& name, Format& out)
+{
+    if(name == "int16") out = Format::Pcm16;
+    else if(name == "int24") out = Format::Pcm24;
+    else if(name == "int32") out = Format::Pcm32;
+    else if(name == "float") out = Format::Float32;
+    else return false;
+    return true;
+}
+
+bool DecodeFmt(const uint8_t* body, size_t size, Info& info)
+{
+    if(size < 16)
+        return false;
+    uint16_t       format   = ReadU16(body);
+    const uint16_t channels = ReadU16(body + 2);
+    const uint16_t bits     = ReadU16(body + 14);
+    if(format == kFormatExtensible && size >= 40)
+        format = ReadU16(body + 24); // first two bytes of the subformat GUID
+
+    if(channels == 0)
+        return false;
+    if(format == kFormatFloat && bits == 32)
+        info.format = Format::Float32;
+    else if(format == kFormatPcm && bits == 16)
+        info.format = Format::Pcm16;
+    else if(format == kFormatPcm && bits == 24)
+        info.format = Format::Pcm24;
+    else if(format == kFormatPcm && bits == 32)
+        info.format = Format::Pcm32;
+    else
+        return false;
+
+    info.channels   = channels;
+    info.sampleRate = static_cast<float>(ReadU32(body + 4));
+    return true;
+}
+
+void MakeHeader(uint8_t* h, float sampleRate, size_t channels, Format format, uint64_t dataBytes)
+{
+    // RF64 sets the 32-bit RIFF and data sizes to 0xFFFFFFFF; the real ones are in ds64
+    const bool     rf64     = dataBytes > kMaxDataBytes;
+    const uint32_t bytes    = static_cast<uint32_t>(BytesPerSample(format));
+    const uint64_t riffSize = dataBytes + (kHeaderSize - 8);
+    std::memset(h, 0, kHeaderSize);
+    std::memcpy(h, rf64 ? "RF64" : "RIFF", 4);
+    PutU32(h + 4, rf64 ? 0xFFFFFFFFu : static_cast<uint32_t>(riffSize));
+    std::memcpy(h + 8, "WAVE", 4);
+    std::memcpy(h + 12, rf64 ? "ds64" : "JUNK", 4);
+    PutU32(h + 16, 28);
+    if(rf64)
+    {
+        PutU64(h + 20, riffSize);
+        PutU64(h + 28, dataBytes);
+        PutU64(h + 36, dataBytes / (channels * bytes)); // sample frames; no table (h + 44 = 0)
+    }
+    std::memcpy(h + 48, "fmt ", 4);
+    PutU32(h + 52, 16);
+    PutU16(h + 56, format == Format::Float32 ? kFormatFloat : kFormatPcm);
+    PutU16(h + 58, static_cast<uint16_t>(channels));
+    PutU32(h + 60, static_cast<uint32_t>(sampleRate));
+    PutU32(h + 64, static_cast<uint32_t>(sampleRate) * static_cast<uint32_t>(channels) * bytes);
+    PutU16(h + 68, static_cast<uint16_t>(channels * bytes));
+    PutU16(h + 70, static_cast<uint16_t>(8 * bytes));
+    std::memcpy(h + 72, "data", 4);
+    PutU32(h + 76, rf64 ? 0xFFFFFFFFu : static_cast<uint32_t>(dataBytes));
+}
+
+// ---------------- Reader ----------------
+
+Reader::~Reader()
+{
+    if(file_ != nullptr)
+        std::fclose(file_);
+}
+
+bool Reader::Open(const std::string& path, std::string* error)
+{
+    if(file_ != nullptr)
+        std::fclose(file_);
+    file_ = std::fopen(path.c_str(), "rb");
+    if(file_ == nullptr)
+        return Fail(error, "cannot open " + path);
+
+    uint8_t    riff[12];
+    const bool ok   = std::fread(riff, 1, 12, file_) == 12;
+    const bool rf64 = ok && std::memcmp(riff, "RF64", 4) == 0;
+    if(!ok || (!rf64 && std::memcmp(riff, "RIFF", 4) != 0) || std::memcmp(riff + 8, "WAVE", 4) != 0)
+        return Fail(error, path + ": not a RIFF/WAVE or RF64 file");
+
+    // Walk the chunk headers; each chunk is padded to an even size. In RF64 the 32-bit data
+    // size is 0xFFFFFFFF and the real one is in the ds64 chunk that comes first.
+    bool     haveFmt  = false;
+    uint64_t ds64Data = 0;
+    uint64_t pos      = 12;
+    while(true)
+    {
+        uint8_t chunk[8];
+        if(std::fseek(file_, static_cast<long>(pos), SEEK_SET) != 0 || std::fread(chunk, 1, 8, file_) != 8)
+            return Fail(error, path + ": missing fmt or data chunk");
+        const uint32_t size = ReadU32(chunk + 4);
+
+        if(std::memcmp(chunk, "ds64", 4) == 0 && size >= 16)
+        {
+            uint8_t body[16];
+            if(std::fread(body, 1, 16, file_) == 16)
+                ds64Data = ReadU64(body + 8);
+        }
+        else if(std::memcmp(chunk, "fmt ", 4) == 0)
+        {
+            uint8_t      body[40] = {};
+            const size_t n        = std::fread(body, 1, size < 40 ? size : 40, file_);
+            if(!DecodeFmt(body, n, info_))
+                return Fail(error, path + ": unsupported sample format");
+            haveFmt = true;
+        }
+        else if(std::memcmp(chunk, "data", 4) == 0)
+        {
+            const uint64_t dataSize = (rf64 && size == 0xFFFFFFFFu) ? ds64Data : size;
+            info_.dataOffset        = pos + 8;
+            std::fseek(file_, 0, SEEK_END);
+            const uint64_t avail = static_cast<uint64_t>(std::ftell(file_)) - info_.dataOffset;
+            remaining_           = (dataSize <= avail) ? dataSize : avail; // tolerate truncated files
+            break;
+        }
+        pos += 8 + static_cast<uint64_t>(size) + (size & 1);
+    }
+
+    if(!haveFmt)
+        return Fail(error, path + ": missing fmt chunk");
+
+    info_.frames = remaining_ / (BytesPerSample(info_.format) * info_.channels);
+    remaining_   = info_.frames;
+    std::fseek(file_, static_cast<long>(info_.dataOffset), SEEK_SET);
+    return true;
+}
+
+size_t Reader::Read(float* interleaved, size_t frames)
+{
+    if(file_ == nullptr)
+        return 0;
+    if(frames > remaining_)
+        frames = static_cast<size_t>(remaining_);
+
+    const size_t frameBytes = BytesPerSample(info_.format) * info_.channels;
+    raw_.resize(frames * frameBytes);
+    frames = std::fread(raw_.data(), frameBytes, frames, file_);
+    ToFloat(raw_.data(), interleaved, frames * info_.channels, info_.format);
+    remaining_ -= frames;
+    return frames;
+}
+
+// ---------------- Writer ----------------
+
+Writer::~Writer()
+{
+    Close();
+}
+
+bool Writer::Open(const std::string& path, float sampleRate, size_t channels, Format format)
+{
+    Close();
+    file_ = std::fopen(path.c_str(), "wb");
+    if(file_ == nullptr)
+        return false;
+    sampleRate_ = sampleRate;
+    channels_   = channels;
+    format_     = format;
+    dataBytes_  = 0;
+
+    uint8_t header[kHeaderSize];
+    MakeHeader(header, sampleRate, channels, format, 0);
+    return std::fwrite(header, 1, kHeaderSize, file_) == kHeaderSize;
+}
+
+bool Writer::Write(const float* interleaved, size_t frames)
+{
+    if(file_ == nullptr)
+        return false;
+    const size_t samples = frames * channels_;
+    raw_.resize(samples * BytesPerSample(format_));
+    FromFloat(interleaved, raw_.data(), samples, format_);
+    dataBytes_ += raw_.size();
+    return std::fwrite(raw_.data(), 1, raw_.size(), file_) == raw_.size();
+}
+
+bool Writer::Close()
+{
+    if(file_ == nullptr)
+        return true;
+
+    // Rewrite the header now that the length is known, as RF64 if it no longer fits RIFF
+    uint8_t header[kHeaderSize];
+    MakeHeader(header, sampleRate_, channels_, format_, dataBytes_);
+    bool ok = std::fseek(file_, 0, SEEK_SET) == 0 && std::fwrite(header, 1, kHeaderSize, file_) == kHeaderSize;
+    ok = (std::fclose(file_) == 0) && ok;
+    file_ = nullptr;
+    return ok;
+}
+
+// ---------------- Whole file ----------------
+
+bool Read(const std::string& path, Audio& out, std::string* error)
+{
+    Reader reader;
+    if(!reader.Open(path, error))
+        return false;
+    const Info& info = reader.GetInfo();
+    out.sampleRate   = info.sampleRate;
+    out.channels     = info.channels;
+    out.samples.resize(info.frames * info.channels);
+    out.samples.resize(reader.Read(out.samples.data(), info.frames) * info.channels);
+    return true;
+}
+
+bool Write(const std::string& path, const Audio& audio, Format format)
+{
+    Writer writer;
+    return writer.Open(path, audio.sampleRate, audio.channels, format)
+           && writer.Write(audio.samples.data(), audio.Frames()) && writer.Close();
+}
+
+} // namespace wav
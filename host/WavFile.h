@@ -0,0 +1,114 @@
+#pragma once
+/**
+ * WavFile.h - WAV reading and writing for the host tools
+ *
+ * Handles PCM 16/24/32-bit and IEEE float 32-bit (plain or WAVE_FORMAT_EXTENSIBLE), any
+ * channel count, converted to interleaved floats in -1..1.
+ *
+ *  - Read() / Write(): whole file in memory (short clips, the simulator).
+ *  - Reader / Writer: streaming in chunks with fixed buffers, for files of any length.
+ *
+ * Outputs over 4 GB are written as RF64 (EBU Tech 3306), which both readers accept.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace wav {
+
+enum class Format
+{
+    Pcm16,
+    Pcm24,
+    Pcm32,
+    Float32,
+};
+
+size_t BytesPerSample(Format format);
+/** Parses "int16", "int24", "int32" or "float"; returns false on anything else. */
+bool   ParseFormat(const std::string& name, Format& out);
+
+struct Info
+{
+    float    sampleRate = 48000.0f;
+    size_t   channels   = 1;
+    Format   format     = Format::Float32;
+    uint64_t frames     = 0;
+    uint64_t dataOffset = 0; // byte offset of the first sample in the file
+};
+
+struct Audio
+{
+    float              sampleRate = 48000.0f;
+    size_t             channels   = 1;
+    std::vector<float> samples; // interleaved
+
+    size_t Frames() const { return channels ? samples.size() / channels : 0; }
+};
+
+/** Decodes the body of a fmt chunk into info.format / channels / sampleRate (shared by the readers). */
+bool DecodeFmt(const uint8_t* body, size_t size, Info& info);
+
+/**
+ * Size of the canonical header the writers produce; the samples follow it directly.
+ * RIFF/WAVE, fmt and data chunks, with a 28-byte chunk after WAVE: JUNK up to kMaxDataBytes,
+ * the ds64 chunk of RF64 above. The samples start at the same offset either way, so a
+ * streaming writer can pick the form once it knows the length.
+ */
+constexpr size_t kHeaderSize = 80;
+/** Most sample bytes a RIFF header can describe: its 32-bit RIFF size counts the header too. */
+constexpr uint64_t kMaxDataBytes = 0xFFFFFFFFu - (kHeaderSize - 8);
+void MakeHeader(uint8_t* header, float sampleRate, size_t channels, Format format, uint64_t dataBytes);
+
+/** Returns false and fills error (if given) on unreadable or unsupported files. */
+bool Read(const std::string& path, Audio& out, std::string* error = nullptr);
+bool Write(const std::string& path, const Audio& audio, Format format = Format::Float32);
+
+/** Streaming reader (RIFF/WAVE or RF64): Open() parses the header, Read() converts the next frames. */
+class Reader
+{
+  public:
+    Reader() = default;
+    ~Reader();
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    bool        Open(const std::string& path, std::string* error = nullptr);
+    const Info& GetInfo() const { return info_; }
+
+    /** Reads up to frames frames into interleaved; returns the number read (0 at the end). */
+    size_t Read(float* interleaved, size_t frames);
+
+  private:
+    FILE*                file_ = nullptr;
+    Info                 info_;
+    uint64_t             remaining_ = 0;
+    std::vector<uint8_t> raw_;
+};
+
+/** Streaming writer: the header is rewritten with the final sizes (RF64 over 4 GB) by Close(). */
+class Writer
+{
+  public:
+    Writer() = default;
+    ~Writer();
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    bool Open(const std::string& path, float sampleRate, size_t channels, Format format);
+    bool Write(const float* interleaved, size_t frames);
+    bool Close();
+
+  private:
+    FILE*                file_ = nullptr;
+    float                sampleRate_ = 48000.0f;
+    size_t               channels_ = 1;
+    Format               format_ = Format::Float32;
+    uint64_t             dataBytes_ = 0;
+    std::vector<uint8_t> raw_;
+};
+
+} // namespace wav
@@ -0,0 +1,126 @@
+/*
+ * bench_denormals.cpp - tail decay cost benchmark
+ *
+ * Renders one second of a driven sine followed by a long silent tail and times every
+ * window of the tail. Without protection the capacitor states turn subnormal and the
+ * per-sample cost climbs (badly on x86); with per-block flushing or an FTZ/DAZ guard
+ * the tail must cost the same as the signal.
+ *
+ * Idle mode is disabled so that the chain really runs through the whole tail.
+ *
+ * Build: make -C host (see host/Makefile)
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "TubeScreamer.h"
+#include "Denormals.h"
+
+namespace {
+
+constexpr float  kSampleRate   = 48000.0f;
+constexpr size_t kBlockSize    = 4;
+constexpr float  kSignalSecs   = 1.0f;
+constexpr float  kTailSecs     = 20.0f;
+constexpr float  kWindowSecs   = 0.5f;
+constexpr float  kDrive        = 250000.0f;
+
+enum class Protection { None, Flush, FtzGuard };
+
+const char* name(Protection p)
+{
+    switch (p)
+    {
+        case Protection::None:     return "none";
+        case Protection::Flush:    return "per-block flush";
+        case Protection::FtzGuard: return "FTZ/DAZ guard";
+    }
+    return "";
+}
+
+// Returns ns/sample for every window; window 0..(signal windows - 1) carry the sine.
+std::vector<double> run(Protection protection)
+{
+    TubeScreamer ts;
+    ts.prepare(kSampleRate);
+    ts.setTone(10000.0f, 0.22e-6f);
+    ts.setIdleThreshold(0.0f);
+    ts.setDenormalFlushing(protection == Protection::Flush);
+
+    const size_t signalSamples = static_cast<size_t>(kSignalSecs * kSampleRate);
+    const size_t totalSamples  = signalSamples + static_cast<size_t>(kTailSecs * kSampleRate);
+    const size_t windowSamples = static_cast<size_t>(kWindowSecs * kSampleRate);
+
+    std::vector<double> nsPerSample;
+    float block[kBlockSize];
+    volatile float sink = 0.0f; // keeps the output alive
+
+    auto render = [&]()
+    {
+        for (size_t start = 0; start < totalSamples; start += windowSamples)
+        {
+            const auto t0 = std::chrono::steady_clock::now();
+            for (size_t n = start; n < start + windowSamples; n += kBlockSize)
+            {
+                for (size_t k = 0; k < kBlockSize; ++k)
+                {
+                    const size_t i = n + k;
+                    block[k] = (i < signalSamples) ? 0.5f * std::sin(2.0f * 3.14159265f * 220.0f * i / kSampleRate) : 0.0f;
+                }
+                ts.processBlock(block, block, kBlockSize, kDrive);
+                sink = sink + block[0];
+            }
+            const auto t1 = std::chrono::steady_clock::now();
+            nsPerSample.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count() / windowSamples);
+        }
+    };
+
+    if (protection == Protection::FtzGuard)
+    {
+        denormals::ScopedNoDenormals guard;
+        render();
+    }
+    else
+    {
+        render();
+    }
+
+    return nsPerSample;
+}
+
+} // namespace
+
+int main()
+{
+    const size_t signalWindows = static_cast<size_t>(kSignalSecs / kWindowSecs);
+    bool constantCost = true;
+
+    for (Protection p : { Protection::None, Protection::Flush, Protection::FtzGuard })
+    {
+        const auto windows = run(p);
+
+        double signalCost = 0.0;
+        for (size_t w = 0; w < signalWindows; ++w)
+            signalCost += windows[w] / signalWindows;
+
+        // The median is robust against scheduler noise; the worst window is reported as well
+        std::vector<double> tail(windows.begin() + signalWindows, windows.end());
+        std::sort(tail.begin(), tail.end());
+        const double medianTail = tail[tail.size() / 2];
+        const double worstTail  = tail.back();
+
+        const double ratio = medianTail / signalCost;
+        std::printf("%-16s signal %7.2f ns/sample  tail median %7.2f  worst %7.2f ns/sample  ratio %5.2f\n",
+                    name(p), signalCost, medianTail, worstTail, ratio);
+
+        if (p != Protection::None && ratio > 1.25)
+            constantCost = false;
+    }
+
+    std::printf("%s\n", constantCost ? "protected tails run at constant cost" : "protected tail cost is NOT constant");
+    return constantCost ? 0 : 1;
+}
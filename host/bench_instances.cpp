@@ -0,0 +1,273 @@
+/*
+ * bench_instances.cpp - how many pedal instances one core sustains
+ *
+ *   bench_instances [--rate hz] [--block n] [--quality good|best|all] [--seconds s]
+ *                   [--budget f] [--miss-rate r] [--cpu n] [--max n]
+ *
+ * Runs N TubeScreamer instances on one thread, as a single audio callback would: every
+ * block, each instance gets new drive and tone targets (slow LFOs, a different phase per
+ * instance) and processes its own input. Each block is timed as a whole against the
+ * deadline block / rate * budget (default budget 1.0, the full block period).
+ *
+ * N doubles and then bisects while the share of blocks missing the deadline stays within
+ * --miss-rate (default 0.001, i.e. p99.9 inside the deadline; 0 allows no miss at all,
+ * which a desktop OS rarely grants). A count that fails is run a second time before it
+ * counts as failed, so a single preemption does not end the search. --cpu pins the thread (Linux) so that the answer is
+ * per core.
+ *
+ * For each diode quality (TubeScreamerT<Quality>) prints the maximum N and, for
+ * one instance and for that maximum, the p50 / p99 / p99.9 block time and the realtime
+ * factor (audio time / processing time, for all N instances together).
+ *
+ * Build: make -C host (see host/Makefile)
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "Denormals.h"
+#include "TestSignals.h"
+#include "TubeScreamer.h"
+
+namespace {
+
+using Clock   = std::chrono::steady_clock;
+using Quality = chowdsp::wdft::DiodeQuality;
+
+struct Options
+{
+    float  rate     = 48000.0f;
+    size_t block    = 48;
+    double seconds  = 1.0;
+    double budget   = 1.0;
+    double missRate = 0.001;
+    size_t max      = 4096;
+};
+
+struct Trial
+{
+    size_t instances = 0;
+    double p50       = 0.0; // block times, microseconds
+    double p99       = 0.0;
+    double p999      = 0.0;
+    double missed    = 0.0; // share of blocks over the deadline
+    double rtf       = 0.0; // audio time / processing time, all instances together
+
+    bool ok(const Options& o) const { return missed <= o.missRate; }
+};
+
+const char* name(Quality q)
+{
+    return q == Quality::Good ? "good" : "best";
+}
+
+template <Quality Q>
+Trial runChain(size_t count, const Options& o, const std::vector<float>& input)
+{
+    std::vector<std::unique_ptr<TubeScreamerT<Q>>> chain;
+    std::vector<std::vector<float>>                out(count, std::vector<float>(o.block));
+    for (size_t i = 0; i < count; ++i)
+    {
+        chain.push_back(std::make_unique<TubeScreamerT<Q>>());
+        chain.back()->prepare(o.rate);
+        chain.back()->setGain(250000.0f);
+        chain.back()->setTone(10000.0f, 47e-9f);
+    }
+
+    const double period   = static_cast<double>(o.block) / o.rate;
+    const double deadline = period * o.budget * 1e6;
+    const size_t warmup   = 50;
+    const size_t blocks   = std::max<size_t>(1000, static_cast<size_t>(o.seconds / period));
+    const size_t span     = input.size() - o.block;
+
+    std::vector<double> times;
+    times.reserve(blocks);
+    double total = 0.0;
+
+    for (size_t b = 0; b < warmup + blocks; ++b)
+    {
+        const double t  = static_cast<double>(b) * period;
+        const auto   t0 = Clock::now();
+        for (size_t i = 0; i < count; ++i)
+        {
+            // Slow LFOs with a different phase per instance keep every smoother moving
+            const double phase = 2.0 * signals::kPi * (0.5 * t + static_cast<double>(i) / static_cast<double>(count));
+            chain[i]->setGainTarget(static_cast<float>(250000.0 + 200000.0 * std::sin(phase)));
+            chain[i]->setToneTarget(static_cast<float>(6000.0 + 4000.0 * std::cos(phase)));
+
+            const size_t offset = (b * o.block + i * 997) % span;
+            chain[i]->processBlock(input.data() + offset, out[i].data(), o.block);
+        }
+        const double us = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+        if (b >= warmup)
+        {
+            times.push_back(us);
+            total += us;
+        }
+    }
+
+    Trial res;
+    res.instances = count;
+    res.missed = static_cast<double>(std::count_if(times.begin(), times.end(), [&](double us) { return us > deadline; }))
+                 / static_cast<double>(times.size());
+    std::sort(times.begin(), times.end());
+    auto pct = [&](double p) { return times[std::min(times.size() - 1, static_cast<size_t>(p * times.size()))]; };
+    res.p50  = pct(0.5);
+    res.p99  = pct(0.99);
+    res.p999 = pct(0.999);
+    res.rtf  = (static_cast<double>(blocks) * period * 1e6) / total;
+    return res;
+}
+
+Trial run(size_t count, Quality quality, const Options& o, const std::vector<float>& input)
+{
+    return quality == Quality::Good ? runChain<Quality::Good>(count, o, input) : runChain<Quality::Best>(count, o, input);
+}
+
+/** A failing count is run once more: one preemption of a short run is not a verdict. */
+Trial confirm(size_t count, Quality quality, const Options& o, const std::vector<float>& input)
+{
+    const Trial first = run(count, quality, o, input);
+    return first.ok(o) ? first : run(count, quality, o, input);
+}
+
+/** Largest instance count that meets the deadline: doubling, then bisection. */
+Trial findMax(Quality quality, const Options& o, const std::vector<float>& input)
+{
+    Trial best;
+    Trial trial = confirm(1, quality, o, input);
+    if (!trial.ok(o))
+        return best;
+
+    size_t lo = 1;
+    size_t hi = 0;
+    best      = trial;
+    while (hi == 0 && lo < o.max)
+    {
+        const size_t n = std::min(2 * lo, o.max);
+        trial          = confirm(n, quality, o, input);
+        if (trial.ok(o))
+        {
+            lo   = n;
+            best = trial;
+        }
+        else
+            hi = n;
+    }
+    while (hi > lo + 1)
+    {
+        const size_t mid = lo + (hi - lo) / 2;
+        trial            = confirm(mid, quality, o, input);
+        if (trial.ok(o))
+        {
+            lo   = mid;
+            best = trial;
+        }
+        else
+            hi = mid;
+    }
+    return best;
+}
+
+void print(const char* label, const Trial& t)
+{
+    std::printf("  %-14s N=%-5zu p50 %8.2f us  p99 %8.2f us  p99.9 %8.2f us  missed %6.3f%%  RTF %8.1fx\n", label,
+                t.instances, t.p50, t.p99, t.p999, 100.0 * t.missed, t.rtf);
+}
+
+bool pinToCpu(int cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options              o;
+    std::vector<Quality> qualities = { Quality::Good, Quality::Best };
+    int                  cpu       = -1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg     = argv[i];
+        const bool        hasNext = i + 1 < argc;
+        if (arg == "--rate" && hasNext)
+            o.rate = std::strtof(argv[++i], nullptr);
+        else if (arg == "--block" && hasNext)
+            o.block = static_cast<size_t>(std::atoi(argv[++i]));
+        else if (arg == "--seconds" && hasNext)
+            o.seconds = std::strtod(argv[++i], nullptr);
+        else if (arg == "--budget" && hasNext)
+            o.budget = std::strtod(argv[++i], nullptr);
+        else if (arg == "--miss-rate" && hasNext)
+            o.missRate = std::strtod(argv[++i], nullptr);
+        else if (arg == "--max" && hasNext)
+            o.max = static_cast<size_t>(std::atoi(argv[++i]));
+        else if (arg == "--cpu" && hasNext)
+            cpu = std::atoi(argv[++i]);
+        else if (arg == "--quality" && hasNext)
+        {
+            const std::string q = argv[++i];
+            if (q == "good")
+                qualities = { Quality::Good };
+            else if (q == "best")
+                qualities = { Quality::Best };
+            else if (q != "all")
+                qualities.clear();
+        }
+        else
+            qualities.clear();
+
+        if (qualities.empty() || o.block == 0 || o.rate <= 0.0f || o.max == 0)
+        {
+            std::fprintf(stderr,
+                         "usage: %s [--rate hz] [--block n] [--quality good|best|all] [--seconds s]\n"
+                         "          [--budget f] [--miss-rate r] [--cpu n] [--max n]\n",
+                         argv[0]);
+            return 2;
+        }
+    }
+
+    if (cpu >= 0 && !pinToCpu(cpu))
+        std::printf("(could not pin to CPU %d)\n", cpu);
+
+    // As in the audio callback: no subnormal slow paths
+    denormals::ScopedNoDenormals noDenormals;
+
+    const std::vector<float> input = signals::GuitarDI(o.rate, static_cast<size_t>(o.rate) * 4);
+    const double             period = 1e6 * static_cast<double>(o.block) / o.rate;
+    std::printf("%.0f Hz, %zu-sample blocks: deadline %.1f us (budget %.2f), miss rate <= %.3f%%\n\n", o.rate, o.block,
+                period * o.budget, o.budget, 100.0 * o.missRate);
+
+    for (Quality q : qualities)
+    {
+        const Trial single = run(1, q, o, input);
+        const Trial most   = findMax(q, o, input);
+        std::printf("quality %s: max %zu instances per core\n", name(q), most.instances);
+        print("one instance", single);
+        if (most.instances > 0)
+            print("at the maximum", most);
+        std::printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,231 @@
+/*
+ * bench_mmap.cpp - input path benchmark: buffered fread vs memory-mapped reads
+ *
+ *   bench_mmap [--mb size] [--channels n] [--runs n] [file.wav]
+ *
+ * Reads a WAV front to back through
+ *   fread        wav::Reader (fread into a buffer, then convert)
+ *   mmap copy    wav::MappedReader::Read (convert / copy out of the mapping)
+ *   mmap direct  wav::MappedReader::ReadDirect (float32 only: no copy at all)
+ * and sums every sample, standing in for the DSP consuming the blocks. Each path runs with
+ * a cold page cache (posix_fadvise(POSIX_FADV_DONTNEED) on the file first, Linux) and a
+ * warm one (the file read once beforehand), and reports the best of --runs.
+ *
+ * Without a file argument a float32 WAV of --mb megabytes (default 512) is generated in
+ * $TMPDIR and removed afterwards. For meaningful cold numbers the file should live on the
+ * disk the renders read from, not on tmpfs.
+ *
+ * Build: make -C host (see host/Makefile)
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "MappedWav.h"
+#include "WavFile.h"
+
+namespace {
+
+constexpr size_t kChunkFrames = 4096;
+
+enum class Path { Fread, MmapCopy, MmapDirect };
+
+const char* name(Path p)
+{
+    switch (p)
+    {
+        case Path::Fread:      return "fread";
+        case Path::MmapCopy:   return "mmap copy";
+        case Path::MmapDirect: return "mmap direct";
+    }
+    return "";
+}
+
+/** Drops the file's pages from the page cache; false where that is not supported. */
+bool dropCache(const std::string& path)
+{
+#ifdef POSIX_FADV_DONTNEED
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    // Dirty pages (a freshly generated file) are not dropped until written back
+    fsync(fd);
+    const bool ok = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(fd);
+    return ok;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+// Eight independent partial sums so the loop vectorizes and the consumer is not the bottleneck
+double sum(const float* x, size_t n)
+{
+    float  s[8] = {};
+    size_t i    = 0;
+    for (; i + 8 <= n; i += 8)
+        for (size_t k = 0; k < 8; ++k)
+            s[k] += x[i + k];
+    for (; i < n; ++i)
+        s[0] += x[i];
+    return (s[0] + s[1]) + (s[2] + s[3]) + (s[4] + s[5]) + (s[6] + s[7]);
+}
+
+/** Reads the whole file through one path; returns seconds, or a negative value on error. */
+double readAll(Path path, const std::string& file, double& checksum)
+{
+    using Clock      = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    checksum         = 0.0;
+
+    if (path == Path::Fread)
+    {
+        wav::Reader reader;
+        if (!reader.Open(file))
+            return -1.0;
+        std::vector<float> buf(kChunkFrames * reader.GetInfo().channels);
+        size_t             frames;
+        while ((frames = reader.Read(buf.data(), kChunkFrames)) > 0)
+            checksum += sum(buf.data(), frames * reader.GetInfo().channels);
+    }
+    else
+    {
+        wav::MappedReader reader;
+        if (!reader.Open(file) || (path == Path::MmapDirect && !reader.IsDirect()))
+            return -1.0;
+        const size_t       channels = reader.GetInfo().channels;
+        std::vector<float> buf(kChunkFrames * channels);
+        while (true)
+        {
+            size_t       frames = kChunkFrames;
+            const float* block  = nullptr;
+            if (path == Path::MmapDirect)
+                block = reader.ReadDirect(frames);
+            else if ((frames = reader.Read(buf.data(), kChunkFrames)) > 0)
+                block = buf.data();
+            if (block == nullptr)
+                break;
+            checksum += sum(block, frames * channels);
+        }
+    }
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+bool generate(const std::string& file, size_t megabytes, size_t channels)
+{
+    wav::Writer writer;
+    if (!writer.Open(file, 48000.0f, channels, wav::Format::Float32))
+        return false;
+    const size_t       frames = (megabytes << 20) / (sizeof(float) * channels);
+    std::vector<float> buf(kChunkFrames * channels);
+    for (size_t done = 0; done < frames; done += kChunkFrames)
+    {
+        const size_t n = (frames - done < kChunkFrames) ? frames - done : kChunkFrames;
+        for (size_t i = 0; i < n * channels; ++i)
+            buf[i] = 0.5f * std::sin(0.01f * static_cast<float>((done * channels + i) % 100000));
+        if (!writer.Write(buf.data(), n))
+            return false;
+    }
+    return writer.Close();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t      megabytes = 512;
+    size_t      channels  = 1;
+    int         runs      = 3;
+    std::string file;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--mb" && i + 1 < argc)
+            megabytes = static_cast<size_t>(std::atoi(argv[++i]));
+        else if (arg == "--channels" && i + 1 < argc)
+            channels = static_cast<size_t>(std::atoi(argv[++i]));
+        else if (arg == "--runs" && i + 1 < argc)
+            runs = std::atoi(argv[++i]);
+        else if (arg[0] != '-')
+            file = arg;
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--mb size] [--channels n] [--runs n] [file.wav]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    const bool generated = file.empty();
+    if (generated)
+    {
+        const char* tmp = std::getenv("TMPDIR");
+        file            = std::string(tmp != nullptr ? tmp : "/tmp") + "/ts_bench_mmap.wav";
+        std::printf("generating %zu MB float32 x %zu ch: %s\n", megabytes, channels, file.c_str());
+        if (channels == 0 || !generate(file, megabytes, channels))
+        {
+            std::fprintf(stderr, "cannot write %s\n", file.c_str());
+            return 1;
+        }
+    }
+
+    wav::Reader probe;
+    std::string error;
+    if (!probe.Open(file, &error))
+    {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    const wav::Info& info = probe.GetInfo();
+    const double     mb   = static_cast<double>(info.frames * info.channels * wav::BytesPerSample(info.format))
+                      / (1 << 20);
+    std::printf("%.0f MB, %llu frames x %zu ch, %zu-byte samples\n\n", mb,
+                static_cast<unsigned long long>(info.frames), info.channels, wav::BytesPerSample(info.format));
+
+    const bool canDrop = dropCache(file);
+    if (!canDrop)
+        std::printf("(cannot drop the page cache here: cold runs are skipped)\n");
+
+    std::printf("%-12s  %-5s  %9s  %10s\n", "path", "cache", "best ms", "MB/s");
+    for (Path path : { Path::Fread, Path::MmapCopy, Path::MmapDirect })
+    {
+        for (bool cold : { true, false })
+        {
+            if (cold && !canDrop)
+                continue;
+
+            double best = -1.0;
+            double checksum;
+            for (int r = 0; r < runs; ++r)
+            {
+                if (cold)
+                    dropCache(file);
+                else
+                    readAll(path, file, checksum); // warm up
+
+                const double t = readAll(path, file, checksum);
+                if (t < 0.0)
+                    break;
+                best = (best < 0.0 || t < best) ? t : best;
+            }
+
+            if (best < 0.0)
+                std::printf("%-12s  %-5s  %9s  %10s\n", name(path), cold ? "cold" : "warm", "-", "n/a");
+            else
+                std::printf("%-12s  %-5s  %9.1f  %10.0f   (checksum %.6g)\n", name(path), cold ? "cold" : "warm",
+                            best * 1e3, mb / best, checksum);
+        }
+    }
+
+    if (generated)
+        std::remove(file.c_str());
+    return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * bench_profile.cpp - where the cycles go inside the full chain (StageProfiler.h)
+ *
+ *   bench_profile [--rate hz] [--block n] [--seconds s] [--quality good|best] [--hist stage]
+ *
+ * --seconds is the profiled length (default 10); a one-second warm-up runs before it.
+ *
+ * Unlike bench_stages, which times each stage alone, this runs the real TubeScreamer on a
+ * synthetic guitar DI in blocks, as the audio callback does, with the per-stage hooks of
+ * TubeScreamer::processOversampled() compiled in: the core sources are built a second time
+ * with TS_PROFILE_STAGES=1 for this tool only, so libtscore and every other tool keep the
+ * hook-free code.
+ *
+ * Prints, per stage, the number of samples, the mean, p50, p99 and maximum in ticks of
+ * the profiler's clock, and each stage's share of the profiled total. The overhead of one
+ * scope (two counter reads) is printed too: it is included in every number. --hist prints
+ * the histogram of one stage (upsample, clipA, clipB, clipC, tone, downsample).
+ *
+ * Build: make -C host (see host/Makefile)
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "Denormals.h"
+#include "StageProfiler.h"
+#include "TestSignals.h"
+#include "TubeScreamer.h"
+
+#if !TS_PROFILE_STAGES
+#error "bench_profile must be built with TS_PROFILE_STAGES=1 (see host/Makefile)"
+#endif
+
+namespace {
+
+void printHistogram(const profile::Histogram& h)
+{
+    uint32_t peak = 0;
+    for (size_t i = 0; i < profile::Histogram::kBins; ++i)
+        peak = h.Bin(i) > peak ? h.Bin(i) : peak;
+
+    for (size_t i = 0; i < profile::Histogram::kBins; ++i)
+    {
+        if (h.Bin(i) == 0)
+            continue;
+        const int bar = static_cast<int>(50.0 * h.Bin(i) / peak + 0.5);
+        std::printf("  >= %8u  %10u  %.*s\n", profile::Histogram::BinLow(i), h.Bin(i), bar,
+                    "##################################################");
+    }
+}
+
+/** Warm-up samples first, then the rest of the input in blocks with clean histograms. */
+template <chowdsp::wdft::DiodeQuality Q>
+void runChain(float rate, size_t block, const std::vector<float>& input, size_t warmup)
+{
+    std::vector<float> output(block);
+
+    TubeScreamerT<Q> ts;
+    ts.prepare(rate);
+    ts.setGain(250000.0f);
+    ts.setTone(10000.0f, 47e-9f);
+    ts.setIdleThreshold(0.0f); // profile the DSP, not the silence shortcut
+
+    for (size_t n = 0; n + block <= warmup; n += block)
+        ts.processBlock(input.data() + n, output.data(), block);
+    profile::ClearAll();
+    for (size_t n = warmup; n + block <= input.size(); n += block)
+        ts.processBlock(input.data() + n, output.data(), block);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    float       rate    = 48000.0f;
+    size_t      block   = 4;
+    double      seconds = 10.0;
+    bool        good    = false;
+    std::string hist;
+    bool        ok      = true;
+
+    for (int i = 1; i < argc && ok; ++i)
+    {
+        const std::string arg     = argv[i];
+        const bool        hasNext = i + 1 < argc;
+        if (arg == "--rate" && hasNext)
+            rate = std::strtof(argv[++i], nullptr);
+        else if (arg == "--block" && hasNext)
+            block = static_cast<size_t>(std::atoi(argv[++i]));
+        else if (arg == "--seconds" && hasNext)
+            seconds = std::strtod(argv[++i], nullptr);
+        else if (arg == "--quality" && hasNext)
+        {
+            const std::string q = argv[++i];
+            good                = (q == "good");
+            ok                  = good || q == "best";
+        }
+        else if (arg == "--hist" && hasNext)
+            hist = argv[++i];
+        else
+            ok = false;
+    }
+
+    bool histKnown = hist.empty();
+    for (size_t s = 0; s < profile::kNumStages; ++s)
+        histKnown = histKnown || hist == profile::StageName(static_cast<profile::Stage>(s));
+
+    if (!ok || !histKnown || rate <= 0.0f || block == 0 || seconds <= 0.0)
+    {
+        std::fprintf(stderr,
+                     "usage: %s [--rate hz] [--block n] [--seconds s] [--quality good|best] [--hist stage]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    // As in the audio callback: no subnormal slow paths
+    denormals::ScopedNoDenormals noDenormals;
+
+    // One warm-up second on top of the profiled length, both in whole blocks (at least one)
+    const size_t warmup   = (static_cast<size_t>(rate) + block - 1) / block * block;
+    const size_t samples  = std::max<size_t>(1, static_cast<size_t>(rate * seconds));
+    const size_t profiled = (samples + block - 1) / block * block;
+    const std::vector<float> input = signals::GuitarDI(rate, warmup + profiled);
+    if (good)
+        runChain<chowdsp::wdft::DiodeQuality::Good>(rate, block, input, warmup);
+    else
+        runChain<chowdsp::wdft::DiodeQuality::Best>(rate, block, input, warmup);
+
+    uint64_t total = 0;
+    for (const profile::Histogram& h : profile::histograms)
+        total += h.Sum();
+
+    std::printf("%.0f Hz, %zu-sample blocks, %s diodes; ticks are %s, one scope costs %u\n\n", rate, block,
+                good ? "good" : "best", profile::Clock::Unit(), profile::ScopeOverhead());
+    std::printf("%-11s %10s %8s %6s %6s %8s %7s\n", "stage", "samples", "mean", "p50", "p99", "max", "share");
+    for (size_t s = 0; s < profile::kNumStages; ++s)
+    {
+        const profile::Histogram& h = profile::histograms[s];
+        std::printf("%-11s %10u %8.1f %6u %6u %8u %6.1f%%\n", profile::StageName(static_cast<profile::Stage>(s)),
+                    h.Count(), h.Mean(), h.Percentile(0.5), h.Percentile(0.99), h.Max(),
+                    total > 0 ? 100.0 * h.Sum() / total : 0.0);
+    }
+
+    if (!hist.empty())
+    {
+        for (size_t s = 0; s < profile::kNumStages; ++s)
+            if (hist == profile::StageName(static_cast<profile::Stage>(s)))
+            {
+                std::printf("\n%s (bin lower edge, count):\n", hist.c_str());
+                printHistogram(profile::histograms[s]);
+            }
+    }
+    return 0;
+}
@@ -0,0 +1,434 @@
+/*
+ * bench_stages.cpp - per-stage microbenchmarks of the DSP hot path
+ *
+ *   bench_stages [--runs n] [--filter text] [--json file|-] [--label text]
+ *
+ * Times every part of the chain in isolation, then the whole chain, on realistic signals:
+ * a synthetic guitar DI (plucked notes with decaying harmonics, peaks around -6 dBFS) is run through
+ * the real stages once, and each stage is then benchmarked on the signal it actually sees in
+ * the chain (ClipWDFb on ClipWDFa's output, the diode pair on the incident waves captured
+ * at the root of the clipper, omega4 on the arguments eqn (39) passes it, and so on).
+ *
+ * Every result is ns per sample: the mean, standard deviation, median and minimum over
+ * --runs timed runs (default 21), each long enough (>= 2 ms) for the clock to be precise.
+ * Outputs go to a buffer that is passed through an empty asm statement, so the compiler
+ * can neither drop the work nor hoist it out of the repetition loop.
+ *
+ * --json writes the same numbers as JSON (to a file, or stdout with "-", the table then
+ * going to stderr) for tracking across commits; --label is copied into it (e.g. the commit hash).
+ *
+ * Build: make -C host (see host/Makefile)
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <chowdsp_wdf/chowdsp_wdf.h>
+
+#include "ClipWDFa.h"
+#include "ClipWDFb.h"
+#include "ClipWDFc.h"
+#include "DiodePairRoot.h"
+#include "FIRFilter.h"
+#include "IIRFilter.h"
+#include "Oversampler2x.h"
+#include "RCFilter.h"
+#include "TSClipping.h"
+#include "TestSignals.h"
+#include "TubeScreamer.h"
+
+namespace {
+
+constexpr float  kSampleRate = 48000.0f;
+constexpr size_t kSignalSize = 48000; // one second per pass
+constexpr double kMinRunNs   = 2e6;
+
+using Clock = std::chrono::steady_clock;
+
+// Makes the optimizer assume the memory behind p is read and written
+inline void escape(const void* p)
+{
+    asm volatile("" : : "g"(p) : "memory");
+}
+
+struct Result
+{
+    std::string name;
+    double      mean   = 0.0; // ns per sample
+    double      stddev = 0.0;
+    double      median = 0.0;
+    double      min    = 0.0;
+    size_t      runs   = 0;
+
+    double msamplesPerSecond() const { return median > 0.0 ? 1e3 / median : 0.0; }
+};
+
+/** Times pass() (which processes samples samples) and returns ns per sample statistics. */
+Result measure(const std::string& name, size_t samples, size_t runs, const std::function<void()>& pass)
+{
+    // Warm up, and find how many passes make a run long enough to time
+    pass();
+    size_t reps = 1;
+    while (true)
+    {
+        const auto t0 = Clock::now();
+        for (size_t r = 0; r < reps; ++r)
+            pass();
+        const double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+        if (ns >= kMinRunNs)
+            break;
+        reps *= 2;
+    }
+
+    std::vector<double> perSample;
+    for (size_t run = 0; run < runs; ++run)
+    {
+        const auto t0 = Clock::now();
+        for (size_t r = 0; r < reps; ++r)
+            pass();
+        const double ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count();
+        perSample.push_back(ns / static_cast<double>(reps * samples));
+    }
+
+    Result res;
+    res.name = name;
+    res.runs = runs;
+    for (double x : perSample)
+        res.mean += x;
+    res.mean /= static_cast<double>(runs);
+    for (double x : perSample)
+        res.stddev += (x - res.mean) * (x - res.mean);
+    res.stddev = std::sqrt(res.stddev / static_cast<double>(runs > 1 ? runs - 1 : 1));
+    std::sort(perSample.begin(), perSample.end());
+    res.median = perSample[runs / 2];
+    res.min    = perSample.front();
+    return res;
+}
+
+// Replica of the ClipWDFc tree in the templated API, so that the root diode pair can be
+// swapped between qualities and its incident waves read
+template <chowdsp::wdft::DiodeQuality Q>
+struct DiodeTree
+{
+    chowdsp::wdft::ResistiveCurrentSourceT<float> Is { 5000.0f + 250000.0f };
+    chowdsp::wdft::CapacitorT<float>              C4 { 51.0e-11f }; // as in ClipWDFc
+    chowdsp::wdft::WDFParallelT<float, decltype(Is), decltype(C4)> P1 { Is, C4 };
+    chowdsp::wdft::DiodePairT<float, decltype(P1), Q>              dp { P1, 25e-9f };
+
+    DiodeTree() { C4.prepare(kSampleRate); }
+};
+
+// FIR taps: windowed-sinc low-pass at a quarter of the sample rate
+std::vector<float> lowpassTaps(size_t length)
+{
+    std::vector<float> taps(length);
+    const double       mid = 0.5 * static_cast<double>(length - 1);
+    for (size_t n = 0; n < length; ++n)
+    {
+        const double x   = static_cast<double>(n) - mid;
+        const double s   = (x == 0.0) ? 0.5 : std::sin(0.5 * signals::kPi * x) / (signals::kPi * x);
+        const double win = 0.54 - 0.46 * std::cos(2.0 * signals::kPi * static_cast<double>(n) / static_cast<double>(length - 1));
+        taps[n]          = static_cast<float>(s * win);
+    }
+    return taps;
+}
+
+std::string jsonEscape(const std::string& s)
+{
+    std::string out;
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+void writeJson(FILE* f, const std::vector<Result>& results, const std::string& label, size_t runs)
+{
+    std::fprintf(f, "{\n  \"benchmark\": \"bench_stages\",\n  \"label\": \"%s\",\n", jsonEscape(label).c_str());
+    std::fprintf(f, "  \"compiler\": \"%s\",\n  \"sample_rate\": %.0f,\n  \"runs\": %zu,\n  \"results\": [\n",
+                 jsonEscape(__VERSION__).c_str(), kSampleRate, runs);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result& r = results[i];
+        std::fprintf(f,
+                     "    {\"name\": \"%s\", \"ns_per_sample\": {\"mean\": %.4f, \"stddev\": %.4f, \"median\": %.4f, "
+                     "\"min\": %.4f}, \"msamples_per_s\": %.3f}%s\n",
+                     jsonEscape(r.name).c_str(), r.mean, r.stddev, r.median, r.min, r.msamplesPerSecond(),
+                     i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(f, "  ]\n}\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    size_t      runs = 21;
+    std::string filter;
+    std::string jsonPath;
+    std::string label;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--runs" && i + 1 < argc)
+            runs = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        else if (arg == "--filter" && i + 1 < argc)
+            filter = argv[++i];
+        else if (arg == "--json" && i + 1 < argc)
+            jsonPath = argv[++i];
+        else if (arg == "--label" && i + 1 < argc)
+            label = argv[++i];
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--runs n] [--filter text] [--json file|-] [--label text]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // ---- Signals as each stage sees them in the chain
+    const std::vector<float> di = signals::GuitarDI(kSampleRate, kSignalSize);
+    std::vector<float>       aOut(kSignalSize), bOut(kSignalSize), cOut(kSignalSize);
+    {
+        ClipWDFa a;
+        ClipWDFb b;
+        ClipWDFc<> c;
+        a.prepare(kSampleRate);
+        b.prepare(kSampleRate);
+        c.prepare(kSampleRate);
+        c.setPotResitanceValue(250000.0f);
+        for (size_t n = 0; n < kSignalSize; ++n)
+        {
+            aOut[n] = a.processSample(di[n]);
+            bOut[n] = b.processSample(aOut[n]);
+            cOut[n] = c.processSample(bOut[n]);
+        }
+    }
+
+    // Incident waves at the diode pair, and the omega4 arguments of eqn (39) for them
+    std::vector<float> waves(kSignalSize), omegaArgs(kSignalSize);
+    {
+        DiodeTree<chowdsp::wdft::DiodeQuality::Best> tree;
+        const float logRIsOverVt = std::log(tree.P1.wdf.R * 25e-9f / 25.85e-3f);
+        for (size_t n = 0; n < kSignalSize; ++n)
+        {
+            tree.Is.setCurrent(bOut[n]);
+            waves[n] = tree.P1.reflected();
+            tree.dp.incident(waves[n]);
+            tree.P1.incident(tree.dp.reflected());
+
+            const float lambdaAOverVt = std::fabs(waves[n]) / 25.85e-3f;
+            omegaArgs[n]              = logRIsOverVt + ((n & 1) ? lambdaAOverVt : -lambdaAOverVt);
+        }
+    }
+
+    std::vector<float> toneSweep(kSignalSize), driveSweep(kSignalSize);
+    for (size_t n = 0; n < kSignalSize; ++n)
+    {
+        const float phase = static_cast<float>(n) / kSignalSize;
+        toneSweep[n]      = 1000.0f + 19000.0f * phase;
+        driveSweep[n]     = 500000.0f * phase;
+    }
+
+    // With JSON on stdout the table goes to stderr
+    FILE* table = (jsonPath == "-") ? stderr : stdout;
+
+    std::vector<float>  out(kSignalSize);
+    std::vector<Result> results;
+    auto run = [&](const std::string& name, size_t samples, const std::function<void()>& pass) {
+        if (!filter.empty() && name.find(filter) == std::string::npos)
+            return;
+        results.push_back(measure(name, samples, runs, pass));
+        const Result& r = results.back();
+        std::fprintf(table, "%-40s %8.2f ns/sample  +-%6.2f  (median %7.2f, min %7.2f)  %9.2f Msamples/s\n", r.name.c_str(),
+                    r.mean, r.stddev, r.median, r.min, r.msamplesPerSecond());
+        std::fflush(table);
+    };
+
+    // ---- Stages
+    {
+        ClipWDFa a;
+        a.prepare(kSampleRate);
+        run("ClipWDFa::processSample", kSignalSize, [&] {
+            for (size_t n = 0; n < kSignalSize; ++n)
+                out[n] = a.processSample(di[n]);
+            escape(out.data());
+        });
+    }
+    {
+        ClipWDFb b;
+        b.prepare(kSampleRate);
+        run("ClipWDFb::processSample", kSignalSize, [&] {
+            for (size_t n = 0; n < kSignalSize; ++n)
+                out[n] = b.processSample(aOut[n]);
+            escape(out.data());
+        });
+    }
+    {
+        ClipWDFc<> c;
+        c.prepare(kSampleRate);
+        c.setPotResitanceValue(250000.0f);
+        run("ClipWDFc::processSample", kSignalSize, [&] {
+            for (size_t n = 0; n < kSignalSize; ++n)
+                out[n] = c.processSample(bOut[n]);
+            escape(out.data());
+        });
+    }
+    {
+        DiodeTree<chowdsp::wdft::DiodeQuality::Good> tree;
+        run("DiodePairT::reflected (Good)", kSignalSize, [&] {
+            for (size_t n = 0; n < kSignalSize; ++n)
+            {
+                tree.dp.incident(waves[n]);
+                out[n] = tree.dp.reflected();
+            }
+            escape(out.data());
+        });
+    }
+    {
+        DiodeTree<chowdsp::wdft::DiodeQuality::Best> tree;
+        run("DiodePairT::reflected (Best)", kSignalSize, [&] {
+            for (size_t n = 0; n < kSignalSize; ++n)
+            {
+                tree.dp.incident(waves[n]);
+                out[n] = tree.dp.reflected();
+            }
+            escape(out.data());
+        });
+    }
+    // The runtime-API pair the chain actually uses, in both qualities
+    auto diodePairRoot = [&](auto quality, const char* name) {
+        chowdsp::wdf::ResistiveCurrentSource<float> Is { 255000.0f };
+        chowdsp::wdf::Capacitor<float>              C4 { 51.0e-11f };
+        chowdsp::wdf::WDFParallel<float>            P1 { &Is, &C4 };
+        DiodePairRoot<decltype(quality)::value>     dp { &P1, 25e-9f };
+        C4.prepare(kSampleRate);
+        run(name, kSignalSize, [&] {
+            for (size_t n = 0; n < kSignalSize; ++n)
+            {
+                dp.incident(waves[n]);
+                out[n] = dp.reflected();
+            }
+            escape(out.data());
+        });
+    };
+    diodePairRoot(std::integral_constant<chowdsp::wdft::DiodeQuality, chowdsp::wdft::DiodeQuality::Good> {},
+                  "DiodePairRoot::reflected (Good)");
+    diodePairRoot(std::integral_constant<chowdsp::wdft::DiodeQuality, chowdsp::wdft::DiodeQuality::Best> {},
+                  "DiodePairRoot::reflected (Best)");
+    run("Omega::omega4", kSignalSize, [&] {
+        for (size_t n = 0; n < kSignalSize; ++n)
+            out[n] = chowdsp::Omega::omega4(omegaArgs[n]);
+        escape(out.data());
+    });
+    {
+        RCFilter tone { 10000.0f, 47e-9f };
+        tone.prepare(2.0f * kSampleRate);
+        run("RCFilter::processSample", kSignalSize, [&] {
+            for (size_t n = 0; n < kSignalSize; ++n)
+                out[n] = tone.processSample(cOut[n]);
+            escape(out.data());
+        });
+        run("RCFilter::setResistor", kSignalSize, [&] {
+            for (size_t n = 0; n < kSignalSize; ++n)
+                tone.setResistor(toneSweep[n]);
+            escape(&tone);
+        });
+    }
+    {
+        ClippingStage clip;
+        clip.prepare(kSampleRate);
+        run("ClippingStage::setDrive", kSignalSize, [&] {
+            for (size_t n = 0; n < kSignalSize; ++n)
+                clip.setDrive(driveSweep[n]);
+            escape(&clip);
+        });
+    }
+    {
+        Oversampler2x os;
+        os.prepare();
+        run("Oversampler2x up + down", kSignalSize, [&] {
+            for (size_t n = 0; n < kSignalSize; ++n)
+            {
+                float x1, x2;
+                os.upsample(cOut[n], x1, x2);
+                out[n] = os.downsample(x2);
+            }
+            escape(out.data());
+        });
+    }
+    for (size_t length : { 8, 16, 32, 64, 128 })
+    {
+        FIRFilter          fir(length);
+        std::vector<float> taps = lowpassTaps(length);
+        run("FIRFilter_Update (" + std::to_string(length) + " taps)", kSignalSize, [&] {
+            for (size_t n = 0; n < kSignalSize; ++n)
+                out[n] = FIRFilter_Update(&fir, di[n], taps.data());
+            escape(out.data());
+        });
+    }
+    {
+        IIRFilter iir;
+        IIRFilter_Init(&iir, 0.9f);
+        run("IIRFilter_Update", kSignalSize, [&] {
+            for (size_t n = 0; n < kSignalSize; ++n)
+                out[n] = IIRFilter_Update(&iir, di[n]);
+            escape(out.data());
+        });
+    }
+
+    // ---- End to end
+    for (size_t block : { 16, 48, 256 })
+    {
+        TubeScreamer ts;
+        ts.prepare(kSampleRate);
+        ts.setGain(250000.0f);
+        ts.setTone(10000.0f, 47e-9f);
+        ts.setIdleThreshold(0.0f);
+        run("TubeScreamer::processBlock (" + std::to_string(block) + ")", kSignalSize, [&] {
+            for (size_t n = 0; n + block <= kSignalSize; n += block)
+                ts.processBlock(di.data() + n, out.data() + n, block);
+            escape(out.data());
+        });
+    }
+    {
+        TubeScreamer ts;
+        ts.prepare(kSampleRate);
+        ts.setTone(10000.0f, 47e-9f);
+        ts.setIdleThreshold(0.0f);
+        constexpr size_t kBlock = 48;
+        run("TubeScreamer::processBlock (48, moving)", kSignalSize, [&] {
+            for (size_t n = 0; n + kBlock <= kSignalSize; n += kBlock)
+            {
+                ts.setGainTarget(driveSweep[n]);
+                ts.setToneTarget(toneSweep[n]);
+                ts.processBlock(di.data() + n, out.data() + n, kBlock);
+            }
+            escape(out.data());
+        });
+    }
+
+    if (!jsonPath.empty())
+    {
+        FILE* f = (jsonPath == "-") ? stdout : std::fopen(jsonPath.c_str(), "w");
+        if (f == nullptr)
+        {
+            std::fprintf(stderr, "cannot write %s\n", jsonPath.c_str());
+            return 1;
+        }
+        writeJson(f, results, label, runs);
+        if (f != stdout)
+            std::fclose(f);
+    }
+    return 0;
+}
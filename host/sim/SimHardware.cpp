@@ -0,0 +1,73 @@
+#include "SimHardware.h"
+
+#include <map>
+#include <utility>
+
+namespace sim {
+
+namespace {
+
+uint64_t                       now_us = 0;
+std::function<void(uint64_t)>  delay_hook;
+std::vector<uint16_t>          adc_words(16, 0);
+std::map<std::pair<uint8_t, uint8_t>, bool> switches;
+std::vector<LedEvent>          led_events;
+InterleavedCallback            audio_callback = nullptr;
+size_t                         block_size     = 4;
+float                          sample_rate    = 48000.0f;
+
+} // namespace
+
+uint64_t NowUs() { return now_us; }
+void     SetNowUs(uint64_t us) { now_us = us; }
+
+void SetDelayHook(std::function<void(uint64_t)> hook) { delay_hook = std::move(hook); }
+
+void Delay(uint64_t us)
+{
+    if(delay_hook)
+        delay_hook(us);
+    else
+        now_us += us;
+}
+
+void SetNumAdcChannels(size_t n)
+{
+    if(n > adc_words.size())
+        adc_words.resize(n, 0);
+}
+
+size_t NumAdcChannels() { return adc_words.size(); }
+
+uint16_t* AdcWord(size_t channel)
+{
+    SetNumAdcChannels(channel + 1);
+    return &adc_words[channel];
+}
+
+void SetPot(size_t channel, float value)
+{
+    if(value < 0.0f) value = 0.0f; else if(value > 1.0f) value = 1.0f;
+    *AdcWord(channel) = static_cast<uint16_t>(value * 65535.0f + 0.5f);
+}
+
+void SetSwitchPressed(uint8_t port, uint8_t pin, bool pressed) { switches[{ port, pin }] = pressed; }
+
+bool SwitchPressed(uint8_t port, uint8_t pin)
+{
+    const auto it = switches.find({ port, pin });
+    return it != switches.end() && it->second;
+}
+
+void RecordLed(uint8_t port, uint8_t pin, bool on) { led_events.push_back({ now_us, port, pin, on }); }
+
+const std::vector<LedEvent>& LedEvents() { return led_events; }
+
+void                SetAudioCallback(InterleavedCallback cb) { audio_callback = cb; }
+InterleavedCallback AudioCallback() { return audio_callback; }
+void                SetBlockSize(size_t frames) { block_size = frames; }
+size_t              BlockSize() { return block_size; }
+float               SampleRate() { return sample_rate; }
+void                SetSampleRate(float sr) { sample_rate = sr; }
+
+} // namespace sim
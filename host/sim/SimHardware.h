@@ -0,0 +1,66 @@
+#pragma once
+/**
+ * SimHardware.h - state shared by the stand-in libDaisy types of the host simulator
+ *
+ * The mock headers in host/sim (daisy_seed.h, hid/ctrl.h, hid/switch.h)
+ * shadow libDaisy when host/sim is first on the include path, so main.cpp and Controls.h
+ * compile unchanged. They read and write the state below instead of touching hardware:
+ *
+ *  - a simulated clock (System::GetNow/GetUs) that only moves when the simulator says so;
+ *  - pot voltages (one ADC word per channel, in the order AdcHandle::Init received them);
+ *  - switch levels by pin, and a log of every GPIO output write (the LEDs);
+ *  - the audio callback registered by StartAudio() and the block size it runs at.
+ *
+ * System::Delay() hands control back to the simulator through a hook, which renders audio
+ * for the delayed time: the firmware's blocking calibration sweep then runs as it would on
+ * the Seed, with the callback "interrupting" the delay.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace sim {
+
+using InterleavedCallback = void (*)(const float* in, float* out, size_t size);
+
+struct LedEvent
+{
+    uint64_t time_us;
+    uint8_t  port;
+    uint8_t  pin;
+    bool     on;
+};
+
+// ---------- Clock ----------
+uint64_t NowUs();
+void     SetNowUs(uint64_t us);
+
+/** Installed by the simulator; called by System::Delay() with the delay in microseconds. */
+void SetDelayHook(std::function<void(uint64_t)> hook);
+void Delay(uint64_t us);
+
+// ---------- Pots (ADC) ----------
+void      SetNumAdcChannels(size_t n);
+size_t    NumAdcChannels();
+uint16_t* AdcWord(size_t channel);
+/** Sets pot channel to a 0..1 position. */
+void      SetPot(size_t channel, float value);
+
+// ---------- Switches and LEDs ----------
+void SetSwitchPressed(uint8_t port, uint8_t pin, bool pressed);
+bool SwitchPressed(uint8_t port, uint8_t pin);
+
+void                         RecordLed(uint8_t port, uint8_t pin, bool on);
+const std::vector<LedEvent>& LedEvents();
+
+// ---------- Audio ----------
+void                SetAudioCallback(InterleavedCallback cb);
+InterleavedCallback AudioCallback();
+void                SetBlockSize(size_t frames);
+size_t              BlockSize();
+float               SampleRate();
+void                SetSampleRate(float sr);
+
+} // namespace sim
@@ -0,0 +1,142 @@
+#include "Timeline.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include "daisy_seed.h"
+#include "SimHardware.h"
+
+namespace sim {
+
+namespace {
+
+// As wired in main.cpp
+const daisy::Pin kFootPins[]   = { daisy::seed::D25, daisy::seed::D26 };
+const daisy::Pin kTogglePins[] = { daisy::seed::D7, daisy::seed::D8, daisy::seed::D9, daisy::seed::D10 };
+
+bool Fail(std::string* error, size_t line, const std::string& what)
+{
+    if(error != nullptr)
+        *error = "line " + std::to_string(line) + ": " + what;
+    return false;
+}
+
+} // namespace
+
+bool Timeline::Parse(const std::string& text, std::string* error)
+{
+    std::vector<Event> parsed;
+    std::istringstream in(text);
+    std::string        raw;
+    size_t             lineNo = 0;
+
+    while(std::getline(in, raw))
+    {
+        ++lineNo;
+        std::istringstream line(raw.substr(0, raw.find('#')));
+        double             time;
+        std::string        control, value;
+        size_t             index;
+        if(!(line >> time))
+            continue; // blank or comment
+        if(!(line >> control >> index >> value))
+            return Fail(error, lineNo, "expected: time control index value [ramp]");
+
+        Event ev{ time, Control::Pot, index, 0.0f, 0.0 };
+        if(control == "pot")
+        {
+            char* end = nullptr;
+            ev.value  = std::strtof(value.c_str(), &end);
+            if(*end != '\0')
+                return Fail(error, lineNo, "bad pot value '" + value + "'");
+            line >> ev.ramp;
+            parsed.push_back(ev);
+            continue;
+        }
+
+        if(control == "foot")
+            ev.control = Control::Foot;
+        else if(control == "toggle")
+            ev.control = Control::Toggle;
+        else
+            return Fail(error, lineNo, "unknown control '" + control + "'");
+
+        const size_t pins = (ev.control == Control::Foot) ? sizeof(kFootPins) / sizeof(kFootPins[0])
+                                                          : sizeof(kTogglePins) / sizeof(kTogglePins[0]);
+        if(index >= pins)
+            return Fail(error, lineNo, control + " index out of range");
+
+        if(value == "down" || value == "on")
+            ev.value = 1.0f;
+        else if(value == "up" || value == "off")
+            ev.value = 0.0f;
+        else if(value == "tap" && ev.control == Control::Foot)
+        {
+            ev.value = 1.0f;
+            parsed.push_back(ev);
+            ev.time += kTapSeconds;
+            ev.value = 0.0f;
+        }
+        else
+            return Fail(error, lineNo, "bad switch state '" + value + "'");
+        parsed.push_back(ev);
+    }
+
+    std::stable_sort(parsed.begin(), parsed.end(), [](const Event& a, const Event& b) { return a.time < b.time; });
+    events_ = std::move(parsed);
+    next_   = 0;
+    ramps_.clear();
+    return true;
+}
+
+bool Timeline::Load(const std::string& path, std::string* error)
+{
+    std::ifstream in(path);
+    if(!in)
+    {
+        if(error != nullptr)
+            *error = "cannot open " + path;
+        return false;
+    }
+    std::stringstream text;
+    text << in.rdbuf();
+    return Parse(text.str(), error);
+}
+
+void Timeline::Apply(double t)
+{
+    for(; next_ < events_.size() && events_[next_].time <= t; ++next_)
+    {
+        const Event& ev = events_[next_];
+        if(ev.control != Control::Pot)
+        {
+            SetSwitch(ev.control, ev.index, ev.value > 0.5f);
+            continue;
+        }
+
+        // A new move on a pot replaces its running ramp
+        ramps_.erase(std::remove_if(ramps_.begin(), ramps_.end(), [&](const Ramp& r) { return r.index == ev.index; }),
+                     ramps_.end());
+        if(ev.ramp > 0.0)
+            ramps_.push_back({ ev.index, ev.time, ev.ramp, *AdcWord(ev.index) / 65535.0f, ev.value });
+        else
+            SetPot(ev.index, ev.value);
+    }
+
+    for(auto it = ramps_.begin(); it != ramps_.end();)
+    {
+        const double x = std::min(1.0, (t - it->start) / it->duration);
+        SetPot(it->index, it->from + static_cast<float>(x) * (it->to - it->from));
+        it = (x >= 1.0) ? ramps_.erase(it) : it + 1;
+    }
+}
+
+void Timeline::SetSwitch(Control control, size_t index, bool pressed)
+{
+    const daisy::Pin pin = (control == Control::Foot) ? kFootPins[index] : kTogglePins[index];
+    SetSwitchPressed(pin.port, pin.pin, pressed);
+}
+
+} // namespace sim
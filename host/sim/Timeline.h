@@ -0,0 +1,63 @@
+#pragma once
+/**
+ * Timeline.h - scripted pot / switch moves for the host simulator
+ *
+ * One event per line, '#' starts a comment, times in seconds from the start of the render:
+ *
+ *   0.0   pot    0  0.5          # pot 0 jumps to 0.5
+ *   1.0   pot    0  0.9  0.25    # pot 0 ramps to 0.9 over 0.25 s
+ *   2.0   foot   0  down         # footswitch 0 pressed ...
+ *   2.1   foot   0  up           # ... and released
+ *   3.0   foot   1  tap          # down, then up 100 ms later
+ *   4.0   toggle 2  on
+ *
+ * Indices follow main.cpp: pots are ADC channels in the order of pot_pins, footswitches and
+ * toggles index foot_pins / toggle_pins.
+ */
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace sim {
+
+class Timeline
+{
+  public:
+    enum class Control { Pot, Foot, Toggle };
+
+    struct Event
+    {
+        double  time;
+        Control control;
+        size_t  index;
+        float   value; // pot position, or 1/0 for pressed/released
+        double  ramp;  // pots only, seconds
+    };
+
+    static constexpr double kTapSeconds = 0.1;
+
+    bool Parse(const std::string& text, std::string* error = nullptr);
+    bool Load(const std::string& path, std::string* error = nullptr);
+
+    /** Applies every event up to time t (seconds) and advances running pot ramps. */
+    void Apply(double t);
+
+    const std::vector<Event>& Events() const { return events_; }
+
+  private:
+    struct Ramp
+    {
+        size_t index;
+        double start, duration;
+        float  from, to;
+    };
+
+    void SetSwitch(Control control, size_t index, bool pressed);
+
+    std::vector<Event> events_;
+    std::vector<Ramp>  ramps_;
+    size_t             next_ = 0;
+};
+
+} // namespace sim
@@ -0,0 +1,4 @@
+#pragma once
+/** daisy_core.h - host stand-in; the firmware needs nothing from it beyond the include. */
+#include <cstddef>
+#include <cstdint>
@@ -0,0 +1,205 @@
+#pragma once
+/**
+ * daisy_seed.h - host stand-in for the libDaisy parts the firmware uses (see SimHardware.h)
+ *
+ * Only what main.cpp, Controls.h and QspiPresetStorage.h touch is provided, with the same
+ * names and signatures as libDaisy, so the firmware sources compile without edits.
+ */
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "SimHardware.h"
+
+// libDaisy prints floats without printf float support; the host has it
+#define FLT_FMT3 "%.3f"
+#define FLT_VAR3(x) static_cast<double>(x)
+
+namespace daisy {
+
+struct Pin
+{
+    uint8_t port = 0;
+    uint8_t pin  = 0;
+
+    constexpr Pin() = default;
+    constexpr Pin(uint8_t port_, uint8_t pin_) : port(port_), pin(pin_) {}
+};
+
+namespace seed {
+// Digital pins on port 0, analog inputs on port 1 (the simulator only needs them distinct)
+constexpr Pin D0{ 0, 0 }, D1{ 0, 1 }, D2{ 0, 2 }, D3{ 0, 3 }, D4{ 0, 4 }, D5{ 0, 5 }, D6{ 0, 6 },
+    D7{ 0, 7 }, D8{ 0, 8 }, D9{ 0, 9 }, D10{ 0, 10 }, D11{ 0, 11 }, D12{ 0, 12 }, D13{ 0, 13 },
+    D14{ 0, 14 }, D15{ 0, 15 }, D16{ 0, 16 }, D17{ 0, 17 }, D18{ 0, 18 }, D19{ 0, 19 },
+    D20{ 0, 20 }, D21{ 0, 21 }, D22{ 0, 22 }, D23{ 0, 23 }, D24{ 0, 24 }, D25{ 0, 25 },
+    D26{ 0, 26 }, D27{ 0, 27 }, D28{ 0, 28 }, D29{ 0, 29 }, D30{ 0, 30 };
+constexpr Pin A0{ 1, 0 }, A1{ 1, 1 }, A2{ 1, 2 }, A3{ 1, 3 }, A4{ 1, 4 }, A5{ 1, 5 },
+    A6{ 1, 6 }, A7{ 1, 7 }, A8{ 1, 8 }, A9{ 1, 9 }, A10{ 1, 10 }, A11{ 1, 11 };
+} // namespace seed
+
+class System
+{
+  public:
+    static uint32_t GetNow() { return static_cast<uint32_t>(sim::NowUs() / 1000); }
+    static uint32_t GetUs() { return static_cast<uint32_t>(sim::NowUs()); }
+    static void     Delay(uint32_t ms) { sim::Delay(static_cast<uint64_t>(ms) * 1000); }
+    static void     DelayUs(uint32_t us) { sim::Delay(us); }
+};
+
+class AdcChannelConfig
+{
+  public:
+    void InitSingle(Pin pin) { pin_ = pin; }
+
+  private:
+    Pin pin_;
+};
+
+class AdcHandle
+{
+  public:
+    void      Init(AdcChannelConfig*, size_t num_channels) { sim::SetNumAdcChannels(num_channels); }
+    void      Start() {}
+    void      Stop() {}
+    uint16_t* GetPtr(uint8_t chn) { return sim::AdcWord(chn); }
+    uint16_t  Get(uint8_t chn) const { return *sim::AdcWord(chn); }
+    float     GetFloat(uint8_t chn) const { return Get(chn) / 65536.0f; }
+};
+
+class GPIO
+{
+  public:
+    enum class Mode { INPUT, OUTPUT, OPEN_DRAIN, ANALOG };
+    enum class Pull { NOPULL, PULLUP, PULLDOWN };
+    enum class Speed { LOW, MEDIUM, HIGH, VERY_HIGH };
+
+    void Init(Pin p, Mode m = Mode::INPUT, Pull pu = Pull::NOPULL, Speed = Speed::LOW)
+    {
+        pin_  = p;
+        mode_ = m;
+        pull_ = pu;
+    }
+
+    /** Outputs are logged (LEDs); inputs read the simulated switch, active low with a pull-up. */
+    void Write(bool state)
+    {
+        if(mode_ == Mode::OUTPUT && state != level_)
+            sim::RecordLed(pin_.port, pin_.pin, state);
+        level_ = state;
+    }
+
+    bool Read() const
+    {
+        if(mode_ == Mode::OUTPUT)
+            return level_;
+        const bool pressed = sim::SwitchPressed(pin_.port, pin_.pin);
+        return (pull_ == Pull::PULLUP) ? !pressed : pressed;
+    }
+
+    void Toggle() { Write(!level_); }
+
+  private:
+    Pin  pin_;
+    Mode mode_  = Mode::INPUT;
+    Pull pull_  = Pull::NOPULL;
+    bool level_ = false;
+};
+
+class AudioHandle
+{
+  public:
+    typedef const float* InterleavingInputBuffer;
+    typedef float*       InterleavingOutputBuffer;
+    typedef void (*InterleavingAudioCallback)(InterleavingInputBuffer in,
+                                              InterleavingOutputBuffer out,
+                                              size_t size);
+};
+
+/** 8 MB of erased flash in RAM; addresses are offsets from the start of the chip. */
+class QSPIHandle
+{
+  public:
+    enum class Result { OK, ERR };
+
+    static constexpr uint32_t kSize       = 0x800000;
+    static constexpr uint32_t kSectorSize = 0x1000;
+
+    void* GetData(uint32_t offset = 0)
+    {
+        Allocate();
+        return flash_.data() + offset;
+    }
+
+    Result Erase(uint32_t start_addr, uint32_t end_addr)
+    {
+        Allocate();
+        start_addr -= start_addr % kSectorSize;
+        if(end_addr > kSize || start_addr >= end_addr)
+            return Result::ERR;
+        std::memset(flash_.data() + start_addr, 0xFF, end_addr - start_addr);
+        return Result::OK;
+    }
+
+    Result Write(uint32_t address, uint32_t size, uint8_t* buffer)
+    {
+        Allocate();
+        if(address + size > kSize)
+            return Result::ERR;
+        for(uint32_t i = 0; i < size; ++i)
+            flash_[address + i] &= buffer[i]; // programming only clears bits
+        return Result::OK;
+    }
+
+  private:
+    void Allocate()
+    {
+        if(flash_.empty())
+            flash_.assign(kSize, 0xFF);
+    }
+
+    std::vector<uint8_t> flash_;
+};
+
+class DaisySeed
+{
+  public:
+    void Init(bool = false) {}
+
+    void   SetAudioBlockSize(size_t size) { sim::SetBlockSize(size); }
+    size_t AudioBlockSize() { return sim::BlockSize(); }
+    float  AudioSampleRate() { return sim::SampleRate(); }
+    float  AudioCallbackRate() { return sim::SampleRate() / static_cast<float>(sim::BlockSize()); }
+
+    void StartAudio(AudioHandle::InterleavingAudioCallback cb) { sim::SetAudioCallback(cb); }
+    void StopAudio() { sim::SetAudioCallback(nullptr); }
+
+    void SetLed(bool) {}
+
+    void StartLog(bool = false) {}
+
+    void PrintLine(const char* format, ...)
+    {
+        va_list args;
+        va_start(args, format);
+        std::vprintf(format, args);
+        va_end(args);
+        std::putchar('\n');
+    }
+
+    void Print(const char* format, ...)
+    {
+        va_list args;
+        va_start(args, format);
+        std::vprintf(format, args);
+        va_end(args);
+    }
+
+    AdcHandle  adc;
+    QSPIHandle qspi;
+};
+
+} // namespace daisy
@@ -0,0 +1,3 @@
+#pragma once
+/** daisysp.h - host stand-in; the firmware only opens the namespace. */
+namespace daisysp {}
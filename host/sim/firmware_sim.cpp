@@ -0,0 +1,313 @@
+/*
+ * firmware_sim.cpp - runs the production firmware (main.cpp) on the host
+ *
+ * main.cpp is compiled unchanged against the stand-in libDaisy headers in host/sim, with
+ * TS_HOST_SIM defined so that its main() steps aside. This driver then plays the part of
+ * the Seed: it advances a simulated clock, runs the firmware's Loop() once per millisecond
+ * (controls, presets, LEDs), calls the real AudioCallback once per audio block with the
+ * input WAV, applies a scripted pot/footswitch timeline and times every callback.
+ *
+ *   firmware_sim [options] input.wav
+ *     -o out.wav          write the processed (right) channel
+ *     -t timeline.txt     pot / footswitch script (see Timeline.h)
+ *     -d seconds          render length (default: input length; the input loops)
+ *     -b frames           audio block size (default: the firmware's)
+ *     --csv timing.csv    one line per callback: start time, frames, ns
+ *     --calibrate         run the firmware's block size sweep (CalibrateBlockSize) and exit
+ *     --telemetry file    log the firmware's telemetry events (Telemetry.h) from a background
+ *                         thread, as the Seed's main loop prints them over USB serial ("-": stdout)
+ *     -v                  print LED changes
+ *
+ * Build: make -C host (see host/Makefile)
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "SimHardware.h"
+#include "Timeline.h"
+#include "../TelemetryLog.h"
+#include "../WavFile.h"
+#include "../../LoadMeter.h"
+
+// From main.cpp
+void   Setup();
+void   Loop();
+size_t CalibrateBlockSize();
+float  MeasureCallbackLoad(size_t blockSize);
+void   RestartAudio(size_t blockSize);
+extern load::LoadMeter loadMeter;
+extern telemetry::Ring<> telemetryRing;
+
+namespace {
+
+constexpr size_t kMaxFrames = 1024;
+
+struct Options
+{
+    std::string input, output, timeline, csv, telemetry;
+    double      duration  = 0.0;
+    size_t      blockSize = 0;
+    bool        calibrate = false;
+    bool        verbose   = false;
+};
+
+struct CallbackTiming
+{
+    uint64_t start_us;
+    size_t   frames;
+    double   ns;
+};
+
+class Simulator
+{
+  public:
+    Simulator(const wav::Audio& input, sim::Timeline& timeline) : input_(input), timeline_(timeline)
+    {
+        in_.resize(2 * kMaxFrames);
+        out_.resize(2 * kMaxFrames);
+    }
+
+    /** Runs the audio interrupt and, unless the firmware is blocked in a Delay, its main loop. */
+    void RunFor(uint64_t us, bool mainLoop)
+    {
+        const uint64_t end = sim::NowUs() + us;
+        while(true)
+        {
+            const uint64_t nextBlock = static_cast<uint64_t>(nextBlockUs_);
+            if(mainLoop && nextLoopUs_ <= nextBlock && nextLoopUs_ < end)
+            {
+                sim::SetNowUs(nextLoopUs_);
+                timeline_.Apply(nextLoopUs_ * 1e-6);
+                Loop();
+                nextLoopUs_ += 1000;
+            }
+            else if(nextBlock < end)
+            {
+                sim::SetNowUs(nextBlock);
+                if(!mainLoop)
+                    timeline_.Apply(nextBlock * 1e-6);
+                RunBlock();
+            }
+            else
+                break;
+        }
+        sim::SetNowUs(end);
+    }
+
+    const std::vector<float>&          Output() const { return output_; }
+    const std::vector<CallbackTiming>& Timings() const { return timings_; }
+    void                               ClearTimings() { timings_.clear(); }
+
+  private:
+    void RunBlock()
+    {
+        const size_t frames = std::min(sim::BlockSize(), kMaxFrames);
+        nextBlockUs_ += 1.0e6 * static_cast<double>(frames) / sim::SampleRate();
+
+        const auto callback = sim::AudioCallback();
+        if(callback == nullptr) // audio stopped (block size change)
+            return;
+
+        // Mono input goes to both channels; the firmware processes the right one
+        const size_t channels = input_.channels;
+        for(size_t n = 0; n < frames; ++n)
+        {
+            const size_t frame = (inputFrame_ + n) % input_.Frames();
+            in_[2 * n]         = input_.samples[frame * channels];
+            in_[2 * n + 1]     = input_.samples[frame * channels + (channels > 1 ? 1 : 0)];
+        }
+        inputFrame_ = (inputFrame_ + frames) % input_.Frames();
+
+        const auto t0 = std::chrono::steady_clock::now();
+        callback(in_.data(), out_.data(), 2 * frames);
+        const auto t1 = std::chrono::steady_clock::now();
+
+        timings_.push_back({ sim::NowUs(), frames, std::chrono::duration<double, std::nano>(t1 - t0).count() });
+        for(size_t n = 0; n < frames; ++n)
+            output_.push_back(out_[2 * n + 1]);
+    }
+
+    const wav::Audio&           input_;
+    sim::Timeline&              timeline_;
+    std::vector<float>          in_, out_, output_;
+    std::vector<CallbackTiming> timings_;
+    size_t                      inputFrame_  = 0;
+    double                      nextBlockUs_ = 0.0;
+    uint64_t                    nextLoopUs_  = 0;
+};
+
+void PrintTimingReport(const std::vector<CallbackTiming>& timings)
+{
+    if(timings.empty())
+        return;
+
+    std::vector<double> ns;
+    double              sum = 0.0;
+    for(const CallbackTiming& t : timings)
+    {
+        ns.push_back(t.ns);
+        sum += t.ns;
+    }
+    std::sort(ns.begin(), ns.end());
+
+    const size_t frames   = timings.back().frames;
+    const double budgetNs = 1.0e9 * static_cast<double>(frames) / sim::SampleRate();
+    auto         pct      = [&](double p) { return ns[std::min(ns.size() - 1, static_cast<size_t>(p * ns.size()))]; };
+
+    std::printf("callbacks %zu, %zu frames each, budget %.0f ns\n", ns.size(), frames, budgetNs);
+    std::printf("  mean %.0f ns  p50 %.0f ns  p99 %.0f ns  p99.9 %.0f ns  max %.0f ns\n", sum / ns.size(), pct(0.5),
+                pct(0.99), pct(0.999), ns.back());
+    std::printf("  load: mean %.2f%%  p99 %.2f%%  max %.2f%%\n", 100.0 * sum / ns.size() / budgetNs,
+                100.0 * pct(0.99) / budgetNs, 100.0 * ns.back() / budgetNs);
+}
+
+/** What the firmware's own meter saw, timed inside AudioCallback like on the Seed. */
+void PrintLoadMeter()
+{
+    const load::LoadStats s = loadMeter.Read();
+    std::printf("firmware load meter, %u blocks\n", static_cast<unsigned>(s.blocks));
+    std::printf("  min %.2f%%  avg %.2f%%  max %.2f%%  peak %.2f%%  overruns %u\n", 100.0f * s.min, 100.0f * s.avg,
+                100.0f * s.max, 100.0f * s.peak, static_cast<unsigned>(s.overruns));
+}
+
+bool ParseArgs(int argc, char** argv, Options& opt)
+{
+    for(int i = 1; i < argc; ++i)
+    {
+        const std::string arg  = argv[i];
+        auto              next = [&]() -> const char* { return (i + 1 < argc) ? argv[++i] : nullptr; };
+        const char*       v    = nullptr;
+
+        if(arg == "-o" && (v = next()))
+            opt.output = v;
+        else if(arg == "-t" && (v = next()))
+            opt.timeline = v;
+        else if(arg == "-d" && (v = next()))
+            opt.duration = std::atof(v);
+        else if(arg == "-b" && (v = next()))
+            opt.blockSize = static_cast<size_t>(std::atoi(v));
+        else if(arg == "--csv" && (v = next()))
+            opt.csv = v;
+        else if(arg == "--telemetry" && (v = next()))
+            opt.telemetry = v;
+        else if(arg == "--calibrate")
+            opt.calibrate = true;
+        else if(arg == "-v")
+            opt.verbose = true;
+        else if(arg[0] != '-' && opt.input.empty())
+            opt.input = arg;
+        else
+            return false;
+    }
+    return !opt.input.empty() && opt.blockSize <= kMaxFrames;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options opt;
+    if(!ParseArgs(argc, argv, opt))
+    {
+        std::fprintf(stderr,
+                     "usage: %s [-o out.wav] [-t timeline.txt] [-d seconds] [-b frames] [--csv file] "
+                     "[--telemetry file] [--calibrate] [-v] input.wav\n",
+                     argv[0]);
+        return 2;
+    }
+
+    std::string error;
+    wav::Audio  input;
+    if(!wav::Read(opt.input, input, &error) || input.Frames() == 0)
+    {
+        std::fprintf(stderr, "%s\n", error.empty() ? "empty input" : error.c_str());
+        return 1;
+    }
+
+    sim::Timeline timeline;
+    if(!opt.timeline.empty() && !timeline.Load(opt.timeline, &error))
+    {
+        std::fprintf(stderr, "%s: %s\n", opt.timeline.c_str(), error.c_str());
+        return 1;
+    }
+
+    Simulator simulator(input, timeline);
+    sim::SetSampleRate(input.sampleRate);
+    sim::SetDelayHook([&](uint64_t us) { simulator.RunFor(us, false); });
+
+    // Drained on its own thread while the simulated callback records, as on the Seed
+    using TelemetryLog = telemetry::LogThread<telemetry::Ring<>>;
+    FILE*                         telemetryFile = nullptr;
+    std::unique_ptr<TelemetryLog> telemetryLog;
+    if(!opt.telemetry.empty())
+    {
+        telemetryFile = (opt.telemetry == "-") ? stdout : std::fopen(opt.telemetry.c_str(), "w");
+        if(telemetryFile == nullptr)
+        {
+            std::fprintf(stderr, "cannot write %s\n", opt.telemetry.c_str());
+            return 1;
+        }
+        telemetryLog = std::make_unique<TelemetryLog>(telemetryRing, telemetryFile);
+    }
+
+    timeline.Apply(0.0); // pots start where the script puts them
+    Setup();
+
+    if(opt.calibrate)
+    {
+        MeasureCallbackLoad(CalibrateBlockSize());
+        return 0;
+    }
+
+    if(opt.blockSize > 0)
+        RestartAudio(opt.blockSize); // through the firmware, so its load meter follows
+
+    const double seconds = (opt.duration > 0.0) ? opt.duration : input.Frames() / input.sampleRate;
+    simulator.RunFor(static_cast<uint64_t>(seconds * 1.0e6), true);
+
+    if(telemetryLog)
+    {
+        telemetryLog->Stop();
+        if(telemetryFile != stdout)
+            std::fclose(telemetryFile);
+    }
+
+    PrintTimingReport(simulator.Timings());
+    PrintLoadMeter();
+
+    if(opt.verbose)
+        for(const sim::LedEvent& e : sim::LedEvents())
+            std::printf("%10.3f s  LED %u.%u %s\n", e.time_us * 1e-6, e.port, e.pin, e.on ? "on" : "off");
+
+    if(!opt.csv.empty())
+    {
+        FILE* f = std::fopen(opt.csv.c_str(), "w");
+        if(f == nullptr)
+            return 1;
+        std::fprintf(f, "time_us,frames,ns\n");
+        for(const CallbackTiming& t : simulator.Timings())
+            std::fprintf(f, "%llu,%zu,%.0f\n", static_cast<unsigned long long>(t.start_us), t.frames, t.ns);
+        std::fclose(f);
+    }
+
+    if(!opt.output.empty())
+    {
+        wav::Audio out;
+        out.sampleRate = input.sampleRate;
+        out.channels   = 1;
+        out.samples    = simulator.Output();
+        if(!wav::Write(opt.output, out))
+        {
+            std::fprintf(stderr, "cannot write %s\n", opt.output.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
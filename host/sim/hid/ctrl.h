@@ -0,0 +1,60 @@
+#pragma once
+/**
+ * hid/ctrl.h - host stand-in for libDaisy's AnalogControl
+ *
+ * Same one-pole smoothing as libDaisy: the coefficient is 1 / (slew * rate / 2), applied once
+ * per Process() call to the ADC word scaled to 0..1.
+ */
+
+#include <cstdint>
+
+namespace daisy {
+
+class AnalogControl
+{
+  public:
+    void Init(uint16_t* adcptr, float sr, bool flip = false, bool invert = false, float slew_seconds = 0.002f)
+    {
+        raw_          = adcptr;
+        flip_         = flip;
+        invert_       = invert;
+        slew_seconds_ = slew_seconds;
+        val_          = 0.0f;
+        SetSampleRate(sr);
+    }
+
+    float Process()
+    {
+        float t = static_cast<float>(*raw_) * kAdcScale;
+        if(flip_)
+            t = 1.0f - t;
+        if(invert_)
+            t = -t;
+        val_ += coeff_ * (t - val_);
+        return val_;
+    }
+
+    float    Value() const { return val_; }
+    uint16_t GetRawValue() const { return raw_ ? *raw_ : 0; }
+    float    GetRawFloat() const { return GetRawValue() * kAdcScale; }
+
+    void SetSampleRate(float sr)
+    {
+        const float samples = slew_seconds_ * sr * 0.5f;
+        coeff_ = (samples > 1.0f) ? 1.0f / samples : 1.0f;
+    }
+
+    void SetCoeff(float coeff) { coeff_ = coeff; }
+
+  private:
+    static constexpr float kAdcScale = 1.0f / 65536.0f;
+
+    uint16_t* raw_          = nullptr;
+    float     val_          = 0.0f;
+    float     coeff_        = 1.0f;
+    float     slew_seconds_ = 0.002f;
+    bool      flip_         = false;
+    bool      invert_       = false;
+};
+
+} // namespace daisy
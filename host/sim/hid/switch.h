@@ -0,0 +1,70 @@
+#pragma once
+/**
+ * hid/switch.h - host stand-in for libDaisy's Switch
+ *
+ * Same debouncing as libDaisy: at most one sample per millisecond of (simulated) time into an
+ * 8-bit history; 0x7f is a rising edge, 0x80 a falling edge, 0xff held. Defaults match
+ * Switch::Init(pin): momentary, inverted, pull-up.
+ */
+
+#include <cstdint>
+#include "daisy_seed.h"
+
+namespace daisy {
+
+class Switch
+{
+  public:
+    enum Type { TYPE_TOGGLE, TYPE_MOMENTARY };
+    enum Polarity { POLARITY_NORMAL, POLARITY_INVERTED };
+    enum Pull { PULL_UP, PULL_DOWN, PULL_NONE };
+
+    void Init(Pin pin, float update_rate = 0.f, Type t = TYPE_MOMENTARY,
+              Polarity pol = POLARITY_INVERTED, Pull pu = PULL_UP)
+    {
+        (void)update_rate;
+        (void)t;
+        flip_ = (pol == POLARITY_INVERTED);
+        hw_gpio_.Init(pin, GPIO::Mode::INPUT,
+                      pu == PULL_UP ? GPIO::Pull::PULLUP
+                                    : (pu == PULL_DOWN ? GPIO::Pull::PULLDOWN : GPIO::Pull::NOPULL));
+        state_       = 0x00;
+        last_update_ = System::GetNow();
+    }
+
+    void Debounce()
+    {
+        const uint32_t now = System::GetNow();
+        updated_           = false;
+        if(now - last_update_ >= 1)
+        {
+            last_update_ = now;
+            updated_     = true;
+            const bool in = flip_ ? !hw_gpio_.Read() : hw_gpio_.Read();
+            state_        = static_cast<uint8_t>((state_ << 1) | (in ? 1 : 0));
+            if(state_ == 0x7f)
+                rising_edge_time_ = now;
+        }
+    }
+
+    bool  RisingEdge() const { return updated_ && state_ == 0x7f; }
+    bool  FallingEdge() const { return updated_ && state_ == 0x80; }
+    bool  Pressed() const { return state_ == 0xff; }
+    bool  RawState() const { return flip_ ? !hw_gpio_.Read() : hw_gpio_.Read(); }
+    float TimeHeldMs() const
+    {
+        return Pressed() ? static_cast<float>(System::GetNow() - rising_edge_time_) : 0.f;
+    }
+
+    void SetUpdateRate(float) {} // kept for API compat, as in libDaisy
+
+  private:
+    GPIO     hw_gpio_;
+    uint32_t last_update_      = 0;
+    uint32_t rising_edge_time_ = 0;
+    uint8_t  state_            = 0x00;
+    bool     updated_          = false;
+    bool     flip_             = true;
+};
+
+} // namespace daisy
@@ -0,0 +1,176 @@
+/*
+ * test_paramchannel.cpp - two-thread stress test of ParamChannel.h
+ *
+ *   test_paramchannel [--seconds s]
+ *
+ * A producer thread plays the main loop and a consumer thread plays the audio callback,
+ * both running flat out on one ParamChannel (no sleeps, so the two ends collide as often as
+ * possible; the producer only yields between batches so that a single core interleaves them):
+ *
+ *  - snapshots: the producer publishes a 64-word snapshot whose words all hold the same
+ *    sequence number. Every snapshot the consumer picks up must have all words equal (no
+ *    torn copy), and the sequence numbers it sees must never go backwards;
+ *  - events: the producer posts numbered events into a deliberately small queue and
+ *    remembers the numbers Post() refused. The consumer must receive the others, each
+ *    exactly once and in order: the numbers missing on the consumer side must be exactly the
+ *    ones the producer was told were dropped.
+ *
+ * Exits with 1 on the first violation. Run it under ThreadSanitizer as well:
+ *
+ *   make -C host test                 # release build
+ *   make -C host PROFILE=tsan test    # -fsanitize=thread
+ *
+ * Build: make -C host (see host/Makefile)
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ParamChannel.h"
+
+namespace {
+
+struct Snapshot
+{
+    uint32_t words[64];
+};
+
+struct Event
+{
+    uint32_t seq;
+    uint32_t check; // ~seq, catches a half-written slot
+};
+
+constexpr size_t kQueueSize = 8; // small, so the queue fills and Post() refuses often
+
+using Channel = params::ParamChannel<Snapshot, Event, kQueueSize>;
+
+Snapshot makeSnapshot(uint32_t seq)
+{
+    Snapshot s;
+    for (uint32_t& w : s.words)
+        w = seq;
+    return s;
+}
+
+struct ConsumerResult
+{
+    std::string           error;
+    uint64_t              snapshots = 0;
+    std::vector<uint32_t> missing; // event numbers that never arrived
+    uint32_t              lastEvent = 0;
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    double seconds = 2.0;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--seconds" && i + 1 < argc)
+            seconds = std::strtod(argv[++i], nullptr);
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--seconds s]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    Channel           channel(makeSnapshot(0));
+    std::atomic<bool> producerDone { false };
+
+    std::vector<uint32_t> refused; // producer only until joined
+    uint32_t              posted = 0;
+
+    std::thread producer([&]() {
+        const auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+        uint32_t   seq = 0;
+        while (std::chrono::steady_clock::now() < end)
+        {
+            for (int k = 0; k < 64; ++k)
+            {
+                ++seq;
+                channel.Publish(makeSnapshot(seq));
+                if (!channel.Post({ seq, ~seq }))
+                    refused.push_back(seq);
+            }
+            std::this_thread::yield(); // lets the consumer in on machines with few cores
+        }
+        posted = seq;
+        producerDone.store(true, std::memory_order_release);
+    });
+
+    ConsumerResult result;
+    std::thread    consumer([&]() {
+        uint32_t lastSnapshot = 0;
+        uint32_t nextEvent    = 1;
+        auto     fail         = [&](const char* what, uint32_t a, uint32_t b) {
+            char text[128];
+            std::snprintf(text, sizeof(text), "%s (%u, %u)", what, a, b);
+            result.error = text;
+        };
+
+        while (result.error.empty())
+        {
+            // Read the flag first: once it is set, one more pass sees everything
+            const bool done = producerDone.load(std::memory_order_acquire);
+
+            if (channel.Consume())
+            {
+                const Snapshot& s = channel.Snapshot();
+                for (uint32_t w : s.words)
+                    if (w != s.words[0])
+                        return fail("torn snapshot", s.words[0], w);
+                if (s.words[0] < lastSnapshot)
+                    return fail("snapshot went backwards", lastSnapshot, s.words[0]);
+                lastSnapshot = s.words[0];
+                ++result.snapshots;
+            }
+
+            Event e;
+            while (channel.PopEvent(e))
+            {
+                if (e.check != ~e.seq)
+                    return fail("corrupt event", e.seq, e.check);
+                if (e.seq < nextEvent)
+                    return fail("event out of order or repeated", nextEvent, e.seq);
+                for (; nextEvent < e.seq; ++nextEvent)
+                    result.missing.push_back(nextEvent);
+                nextEvent = e.seq + 1;
+            }
+
+            if (done)
+                break;
+        }
+        result.lastEvent = nextEvent - 1;
+    });
+
+    producer.join();
+    consumer.join();
+
+    // Events after the last one received were refused too, or the check below fails
+    for (uint32_t seq = result.lastEvent + 1; seq <= posted; ++seq)
+        result.missing.push_back(seq);
+
+    if (result.error.empty() && result.missing != refused)
+        result.error = "events lost beyond the ones Post() refused";
+
+    std::printf("%u snapshots published, %llu picked up; %u events posted, %zu refused, %zu missing\n", posted,
+                static_cast<unsigned long long>(result.snapshots), posted, refused.size(), result.missing.size());
+
+    if (!result.error.empty())
+    {
+        std::printf("FAIL: %s\n", result.error.c_str());
+        return 1;
+    }
+    std::printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,161 @@
+/*
+ * test_presets.cpp - PresetBank save / load round trip on RamPresetStorage (Presets.h)
+ *
+ *   test_presets
+ *
+ * Checks the paths the firmware only takes at boot and on a footswitch hold:
+ *
+ *  - Save() then Load() into an empty bank gives back every preset byte for byte, settings
+ *    and precomputed coefficients;
+ *  - Load() at another sample rate keeps the settings and recomputes the coefficients;
+ *  - Load() refuses a blank storage, a flipped byte (checksum), a wrong magic, a wrong preset
+ *    count and a storage too small for the image, and leaves the bank untouched each time
+ *    (the checksum is private, so a damaged header breaks it too: these check that nothing
+ *    slips through, not which test catches it).
+ *
+ * Runs every check and exits with 1 if any failed.
+ *
+ * Build: make -C host (see host/Makefile)
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "Presets.h"
+#include "TubeScreamer.h"
+
+namespace {
+
+constexpr size_t kSlots = 4;
+
+using Bank    = presets::PresetBank<kSlots>;
+using Storage = presets::RamPresetStorage<Bank::kImageSize>;
+
+int failures = 0;
+
+void check(bool ok, const char* what)
+{
+    std::printf("%-52s %s\n", what, ok ? "ok" : "FAIL");
+    failures += ok ? 0 : 1;
+}
+
+bool samePreset(const presets::Preset& a, const presets::Preset& b)
+{
+    return std::memcmp(&a, &b, sizeof(presets::Preset)) == 0;
+}
+
+bool sameBank(const Bank& a, const Bank& b)
+{
+    for (size_t i = 0; i < kSlots; ++i)
+        if (!samePreset(*a.Get(i), *b.Get(i)))
+            return false;
+    return true;
+}
+
+void fill(Bank& bank, const TubeScreamer& ts, float rate)
+{
+    for (size_t i = 0; i < kSlots; ++i)
+    {
+        const float x = static_cast<float>(i + 1) / kSlots;
+        bank.Store(i, { 500000.0f * x, 20000.0f * x, 220e-9f, 0.5f + x, 2.0f - x }, ts, rate);
+    }
+}
+
+/** Saves bank, lets corrupt() damage the image, and expects Load() to refuse it. */
+template <typename Corrupt>
+bool refuses(Bank& bank, const TubeScreamer& ts, float rate, Corrupt corrupt)
+{
+    Storage storage;
+    bank.Save(storage);
+
+    uint8_t image[Bank::kImageSize];
+    storage.Read(image, sizeof(image));
+    corrupt(image);
+    storage.Write(image, sizeof(image));
+
+    Bank target;
+    fill(target, ts, rate);
+    const Bank before = target;
+    return !target.Load(storage, ts, rate) && sameBank(target, before);
+}
+
+} // namespace
+
+int main()
+{
+    const float rate = 48000.0f;
+
+    TubeScreamer ts;
+    ts.prepare(rate);
+
+    Bank bank;
+    fill(bank, ts, rate);
+
+    // Round trip
+    {
+        Storage storage;
+        check(bank.Save(storage) && storage.WriteCount() == 1, "save writes the image once");
+
+        Bank loaded;
+        check(loaded.Load(storage, ts, rate) && sameBank(loaded, bank), "load gives back every preset");
+    }
+
+    // Another sample rate: same settings, coefficients recomputed for the new rate
+    {
+        Storage storage;
+        bank.Save(storage);
+
+        const float  otherRate = 96000.0f;
+        TubeScreamer other;
+        other.prepare(otherRate);
+
+        Bank loaded, expected;
+        fill(expected, other, otherRate);
+
+        bool ok = loaded.Load(storage, other, otherRate);
+        for (size_t i = 0; i < kSlots && ok; ++i)
+            ok = std::memcmp(&loaded.Get(i)->params, &bank.Get(i)->params, sizeof(presets::PresetParams)) == 0
+                 && samePreset(*loaded.Get(i), *expected.Get(i));
+        check(ok, "load at another rate recomputes the coefficients");
+    }
+
+    // Rejections
+    {
+        Storage blank;
+        Bank    target;
+        fill(target, ts, rate);
+        const Bank before = target;
+        check(!target.Load(blank, ts, rate) && sameBank(target, before), "blank storage is refused");
+    }
+
+    check(refuses(bank, ts, rate, [](uint8_t* image) { image[Bank::kImageSize / 2] ^= 0x01; }),
+          "flipped byte is refused (checksum)");
+    check(refuses(bank, ts, rate,
+                  [](uint8_t* image) { image[offsetof(Bank::Header, magic)] ^= 0xFF; }),
+          "wrong magic is refused");
+    check(refuses(bank, ts, rate,
+                  [](uint8_t* image) {
+                      Bank::Header header;
+                      std::memcpy(&header, image, sizeof(header));
+                      header.count = kSlots + 1;
+                      std::memcpy(image, &header, sizeof(header));
+                  }),
+          "wrong preset count is refused");
+
+    {
+        presets::RamPresetStorage<Bank::kImageSize - 1> small;
+        Bank                                            target;
+        check(!bank.Save(small) && small.WriteCount() == 0 && !target.Load(small, ts, rate),
+              "storage smaller than the image is refused");
+    }
+
+    if (failures > 0)
+    {
+        std::printf("FAIL: %d checks\n", failures);
+        return 1;
+    }
+    std::printf("ok\n");
+    return 0;
+}
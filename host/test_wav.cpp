@@ -0,0 +1,170 @@
+/*
+ * test_wav.cpp - WAV / RF64 headers of the host writers, read back by both readers
+ *
+ *   test_wav [--dir path]
+ *
+ *  - a short clip through wav::Writer and wav::MappedWriter comes back sample for sample
+ *    through wav::Reader and wav::MappedReader (float32 and int16);
+ *  - MakeHeader() at the RIFF limit still writes RIFF, one frame past it RF64 with the sizes
+ *    in ds64 and 0xFFFFFFFF in the 32-bit fields;
+ *  - a MappedWriter output of about 6 GB opens in both readers with every frame counted.
+ *    The file is sparse (ftruncate, only the header is written), so it takes no disk space
+ *    on file systems with holes, which is all the usual ones.
+ *
+ * Temporary files go to --dir (default $TMPDIR or /tmp) and are removed. Runs every check
+ * and exits with 1 if any failed.
+ *
+ * Build: make -C host (see host/Makefile)
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "MappedWav.h"
+#include "WavFile.h"
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string& what)
+{
+    std::printf("%-56s %s\n", what.c_str(), ok ? "ok" : "FAIL");
+    failures += ok ? 0 : 1;
+}
+
+uint32_t u32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24); }
+uint64_t u64(const uint8_t* p) { return u32(p) | (static_cast<uint64_t>(u32(p + 4)) << 32); }
+
+std::vector<float> clip(size_t frames, size_t channels)
+{
+    std::vector<float> x(frames * channels);
+    for (size_t n = 0; n < x.size(); ++n)
+        x[n] = 0.9f * static_cast<float>(std::sin(0.01 * static_cast<double>(n)));
+    return x;
+}
+
+bool near(const std::vector<float>& a, const std::vector<float>& b, float tolerance)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t n = 0; n < a.size(); ++n)
+        if (std::fabs(a[n] - b[n]) > tolerance)
+            return false;
+    return true;
+}
+
+/** Reads path with both readers; each must see rate, channels and samples as written. */
+void readBack(const std::string& path, const std::string& name, const std::vector<float>& expected, size_t channels,
+              float tolerance)
+{
+    const size_t frames = expected.size() / channels;
+
+    wav::Reader reader;
+    std::vector<float> got(expected.size());
+    const bool opened = reader.Open(path);
+    const bool ok     = opened && reader.GetInfo().sampleRate == 48000.0f && reader.GetInfo().channels == channels
+                    && reader.GetInfo().frames == frames && reader.Read(got.data(), frames) == frames;
+    check(ok && near(got, expected, tolerance), name + ", wav::Reader");
+
+    wav::MappedReader mapped;
+    std::fill(got.begin(), got.end(), 0.0f);
+    const bool mappedOk = mapped.Open(path) && mapped.GetInfo().channels == channels
+                          && mapped.GetInfo().frames == frames && mapped.Read(got.data(), frames) == frames;
+    check(mappedOk && near(got, expected, tolerance), name + ", MappedReader");
+}
+
+void roundTrip(const std::string& path, wav::Format format, const char* formatName, float tolerance)
+{
+    const size_t             channels = 2, frames = 1000;
+    const std::vector<float> x        = clip(frames, channels);
+
+    wav::Writer writer;
+    bool ok = writer.Open(path, 48000.0f, channels, format);
+    ok      = ok && writer.Write(x.data(), 600) && writer.Write(x.data() + 600 * channels, frames - 600);
+    ok      = writer.Close() && ok;
+    check(ok, std::string("Writer ") + formatName);
+    readBack(path, std::string("Writer ") + formatName, x, channels, tolerance);
+
+    wav::MappedWriter mappedWriter;
+    ok = mappedWriter.Open(path, 48000.0f, channels, format, frames);
+    ok = ok && mappedWriter.Write(500, x.data() + 500 * channels, frames - 500) && mappedWriter.Write(0, x.data(), 500);
+    ok = mappedWriter.Close() && ok;
+    check(ok, std::string("MappedWriter ") + formatName);
+    readBack(path, std::string("MappedWriter ") + formatName, x, channels, tolerance);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* tmp = std::getenv("TMPDIR");
+    std::string dir = (tmp != nullptr && *tmp != '\0') ? tmp : "/tmp";
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--dir" && i + 1 < argc)
+            dir = argv[++i];
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--dir path]\n", argv[0]);
+            return 2;
+        }
+    }
+    const std::string path = dir + "/test_wav_" + std::to_string(static_cast<long>(getpid())) + ".wav";
+
+    // Small files, written and read back
+    roundTrip(path, wav::Format::Float32, "float32", 0.0f);
+    roundTrip(path, wav::Format::Pcm16, "int16", 1.0f / 16384.0f);
+
+    // Headers either side of the RIFF limit (stereo int16: 4-byte frames)
+    {
+        uint8_t        h[wav::kHeaderSize];
+        const uint64_t atLimit = wav::kMaxDataBytes / 4 * 4;
+        wav::MakeHeader(h, 48000.0f, 2, wav::Format::Pcm16, atLimit);
+        check(std::memcmp(h, "RIFF", 4) == 0 && std::memcmp(h + 12, "JUNK", 4) == 0
+                  && u32(h + 4) == atLimit + wav::kHeaderSize - 8 && u32(h + 76) == atLimit,
+              "header at the RIFF limit is RIFF with exact sizes");
+
+        const uint64_t past = atLimit + 4;
+        wav::MakeHeader(h, 48000.0f, 2, wav::Format::Pcm16, past);
+        check(std::memcmp(h, "RF64", 4) == 0 && std::memcmp(h + 12, "ds64", 4) == 0 && u32(h + 4) == 0xFFFFFFFFu
+                  && u32(h + 76) == 0xFFFFFFFFu && u64(h + 20) == past + wav::kHeaderSize - 8 && u64(h + 28) == past
+                  && u64(h + 36) == past / 4,
+              "header past the RIFF limit is RF64 with sizes in ds64");
+    }
+
+    // A sparse output of about 6 GB: header written, samples never touched
+    {
+        const uint64_t    frames = (6ull << 30) / 8; // stereo float32
+        wav::MappedWriter writer;
+        std::string       error;
+        const bool        written = writer.Open(path, 48000.0f, 2, wav::Format::Float32, frames, &error) && writer.Close();
+        check(written, "MappedWriter creates a 6 GB output" + (error.empty() ? "" : " (" + error + ")"));
+
+        wav::Reader reader;
+        check(written && reader.Open(path) && reader.GetInfo().frames == frames, "6 GB output, wav::Reader frame count");
+
+        wav::MappedReader mapped;
+        check(written && mapped.Open(path) && mapped.GetInfo().frames == frames && mapped.IsDirect(),
+              "6 GB output, MappedReader frame count");
+    }
+
+    std::remove(path.c_str());
+
+    if (failures > 0)
+    {
+        std::printf("FAIL: %d checks\n", failures);
+        return 1;
+    }
+    std::printf("ok\n");
+    return 0;
+}
@@ -0,0 +1,367 @@
+/*
+ * ts_accuracy.cpp - accuracy of the realtime chain against the double-precision reference
+ *
+ *   ts_accuracy [--rate hz] [--seconds s] [--runs n] [--filter text]
+ *               [--budget variant=maxabs,null,spectral ...]
+ *
+ * Renders a fixed corpus (guitar DI, a sine, a sweep, noise; each at its own drive and tone)
+ * through reference::Chain (host/ReferenceChain.h) and through each fast variant of
+ * TubeScreamer, and reports per variant and signal:
+ *
+ *   max abs   largest sample error, dBFS
+ *   rms       RMS of the error, dBFS
+ *   null      RMS of the error relative to the RMS of the reference, dB (more negative is
+ *             better: the depth of the null when subtracting one from the other)
+ *   spectral  log-spectral distance: RMS over the bins of the dB difference between the two
+ *             averaged spectra, counting bins 20 Hz..20 kHz within 80 dB of the peak
+ *
+ * next to the speed (ns/sample, best of --runs) and the speed-up over the reference.
+ *
+ * Each variant has an error budget (worst case over the corpus; defaults below, overridden
+ * with --budget, e.g. --budget block/good=-50,-40,0.2). The exit code is 1 if any variant
+ * is over budget, so the harness can gate changes that trade accuracy for speed.
+ *
+ * Build: make -C host (see host/Makefile)
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Denormals.h"
+#include "ReferenceChain.h"
+#include "Spectrum.h"
+#include "TestSignals.h"
+#include "TubeScreamer.h"
+
+namespace {
+
+using Clock   = std::chrono::steady_clock;
+using Quality = chowdsp::wdft::DiodeQuality;
+
+constexpr size_t kBlockSize = 48;
+constexpr size_t kFFTSize   = 4096;
+
+// How the parameters move: the reference gets the same moves, computed exactly
+enum class Control
+{
+    Static,    // fixed drive and tone
+    Glide,     // new drive / tone targets every block (smoothers, segment updates)
+    Modulated, // audio-rate drive / tone positions (modulation tables)
+};
+
+struct Budget
+{
+    double maxAbsDb   = 0.0;
+    double nullDb     = 0.0;
+    double spectralDb = 0.0;
+};
+
+struct Variant
+{
+    const char* name;
+    Control     control;
+    Quality     quality;
+    bool        perSample; // TubeScreamer::processSample() instead of processBlock()
+    Budget      budget;
+};
+
+// Defaults: the measured worst case over the corpus plus about 3 dB (spectral: about twice
+// the measured distance), so that any change which costs accuracy shows up. The floor of all
+// of them is the omega4() approximation in the diode pair, not float precision
+Variant variants[] = {
+    { "sample/best", Control::Static, Quality::Best, true, { -51.0, -41.0, 0.10 } },
+    { "block/best", Control::Static, Quality::Best, false, { -51.0, -41.0, 0.10 } },
+    { "block/good", Control::Static, Quality::Good, false, { -51.0, -41.0, 0.15 } },
+    { "glide/best", Control::Glide, Quality::Best, false, { -51.0, -41.0, 0.10 } },
+    { "mod/best", Control::Modulated, Quality::Best, false, { -51.0, -41.0, 0.10 } },
+};
+
+struct Case
+{
+    const char*        name;
+    std::vector<float> input;
+    float              drive;
+    float              tone;
+};
+
+struct Result
+{
+    double maxAbsDb   = 0.0;
+    double rmsDb      = 0.0;
+    double nullDb     = 0.0;
+    double spectralDb = 0.0;
+};
+
+struct Controls
+{
+    std::vector<float> driveTarget; // one per block
+    std::vector<float> toneTarget;
+    std::vector<float> driveMod;    // one per sample
+    std::vector<float> toneMod;
+};
+
+double Db(double x)
+{
+    return 20.0 * std::log10(std::max(x, 1e-30));
+}
+
+Controls MakeControls(size_t samples, float fs)
+{
+    Controls c;
+    for(size_t start = 0; start < samples; start += kBlockSize)
+    {
+        const double t = static_cast<double>(start) / fs;
+        c.driveTarget.push_back(static_cast<float>(250000.0 + 200000.0 * std::sin(2.0 * signals::kPi * 0.5 * t)));
+        c.toneTarget.push_back(static_cast<float>(6000.0 + 4000.0 * std::cos(2.0 * signals::kPi * 0.7 * t)));
+    }
+    for(size_t n = 0; n < samples; ++n)
+    {
+        const double t = static_cast<double>(n) / fs;
+        c.driveMod.push_back(static_cast<float>(0.5 + 0.45 * std::sin(2.0 * signals::kPi * 2.0 * t)));
+        c.toneMod.push_back(static_cast<float>(0.5 + 0.45 * std::cos(2.0 * signals::kPi * 1.5 * t)));
+    }
+    return c;
+}
+
+double RenderReference(const Case& c, Control control, const Controls& ctl, float fs, std::vector<double>& out)
+{
+    auto chain = std::make_unique<reference::Chain>();
+    chain->setDrive(c.drive);
+    chain->setTone(c.tone, 47e-9);
+    chain->prepare(fs);
+
+    const size_t samples = c.input.size();
+    out.assign(samples, 0.0);
+
+    const auto t0 = Clock::now();
+    for(size_t start = 0, b = 0; start < samples; start += kBlockSize, ++b)
+    {
+        const size_t len = std::min(kBlockSize, samples - start);
+        if(control == Control::Glide)
+        {
+            chain->setDriveTarget(ctl.driveTarget[b]);
+            chain->setToneTarget(ctl.toneTarget[b]);
+        }
+        if(control == Control::Modulated)
+            chain->process(&c.input[start], &out[start], len, &ctl.driveMod[start], &ctl.toneMod[start]);
+        else
+            chain->process(&c.input[start], &out[start], len);
+    }
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+template <Quality Q>
+double RenderChain(const Case& c, const Variant& v, const Controls& ctl, float fs, std::vector<float>& out)
+{
+    auto ts = std::make_unique<TubeScreamerT<Q>>();
+    ts->prepare(fs);
+    ts->setGain(c.drive);
+    ts->setTone(c.tone, 47e-9f);
+
+    const size_t samples = c.input.size();
+    out.assign(samples, 0.0f);
+
+    const auto t0 = Clock::now();
+    if(v.perSample)
+    {
+        for(size_t n = 0; n < samples; ++n)
+            out[n] = ts->processSample(c.input[n], c.drive);
+    }
+    else
+    {
+        for(size_t start = 0, b = 0; start < samples; start += kBlockSize, ++b)
+        {
+            const size_t len = std::min(kBlockSize, samples - start);
+            if(v.control == Control::Glide)
+            {
+                ts->setGainTarget(ctl.driveTarget[b]);
+                ts->setToneTarget(ctl.toneTarget[b]);
+            }
+            if(v.control == Control::Modulated)
+                ts->processBlock(&c.input[start], &out[start], len, &ctl.driveMod[start], &ctl.toneMod[start]);
+            else
+                ts->processBlock(&c.input[start], &out[start], len);
+        }
+    }
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+double RenderVariant(const Case& c, const Variant& v, const Controls& ctl, float fs, std::vector<float>& out)
+{
+    return v.quality == Quality::Good ? RenderChain<Quality::Good>(c, v, ctl, fs, out)
+                                      : RenderChain<Quality::Best>(c, v, ctl, fs, out);
+}
+
+Result Compare(const std::vector<float>& test, const std::vector<double>& ref, float fs)
+{
+    Result res;
+    double maxAbs = 0.0;
+    double errSq  = 0.0;
+    double refSq  = 0.0;
+    for(size_t n = 0; n < ref.size(); ++n)
+    {
+        const double e = static_cast<double>(test[n]) - ref[n];
+        maxAbs         = std::max(maxAbs, std::fabs(e));
+        errSq += e * e;
+        refSq += ref[n] * ref[n];
+    }
+    res.maxAbsDb = Db(maxAbs);
+    res.rmsDb    = Db(std::sqrt(errSq / static_cast<double>(ref.size())));
+    res.nullDb   = Db(std::sqrt(errSq / std::max(refSq, 1e-300)));
+
+    const std::vector<double> pt = spectrum::PowerSpectrum(test.data(), test.size(), kFFTSize);
+    const std::vector<double> pr = spectrum::PowerSpectrum(ref.data(), ref.size(), kFFTSize);
+
+    const double binHz = fs / static_cast<double>(kFFTSize);
+    const size_t lo    = static_cast<size_t>(std::ceil(20.0 / binHz));
+    const size_t hi    = std::min(pr.size() - 1, static_cast<size_t>(20000.0 / binHz));
+    const double floor = *std::max_element(pr.begin() + lo, pr.begin() + hi + 1) * 1e-8; // -80 dB
+
+    double sum  = 0.0;
+    size_t bins = 0;
+    for(size_t k = lo; k <= hi; ++k)
+    {
+        if(pr[k] < floor)
+            continue;
+        const double d = 10.0 * std::log10(std::max(pt[k], 1e-300) / pr[k]);
+        sum += d * d;
+        ++bins;
+    }
+    res.spectralDb = bins > 0 ? std::sqrt(sum / static_cast<double>(bins)) : 0.0;
+    return res;
+}
+
+bool ParseBudget(const std::string& spec)
+{
+    const size_t eq = spec.find('=');
+    if(eq == std::string::npos)
+        return false;
+    const std::string name = spec.substr(0, eq);
+    for(Variant& v : variants)
+    {
+        if(name != v.name)
+            continue;
+        Budget b;
+        if(std::sscanf(spec.c_str() + eq + 1, "%lf,%lf,%lf", &b.maxAbsDb, &b.nullDb, &b.spectralDb) != 3)
+            return false;
+        v.budget = b;
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    float       fs      = 48000.0f;
+    double      seconds = 2.0;
+    int         runs    = 3;
+    std::string filter;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        const std::string arg     = argv[i];
+        const bool        hasNext = i + 1 < argc;
+        bool              ok      = true;
+        if(arg == "--rate" && hasNext)
+            fs = std::strtof(argv[++i], nullptr);
+        else if(arg == "--seconds" && hasNext)
+            seconds = std::strtod(argv[++i], nullptr);
+        else if(arg == "--runs" && hasNext)
+            runs = std::max(1, std::atoi(argv[++i]));
+        else if(arg == "--filter" && hasNext)
+            filter = argv[++i];
+        else if(arg == "--budget" && hasNext)
+            ok = ParseBudget(argv[++i]);
+        else
+            ok = false;
+
+        if(!ok || fs <= 0.0f || seconds <= 0.0)
+        {
+            std::fprintf(stderr,
+                         "usage: %s [--rate hz] [--seconds s] [--runs n] [--filter text]\n"
+                         "          [--budget variant=maxabs,null,spectral ...]\n"
+                         "variants:",
+                         argv[0]);
+            for(const Variant& v : variants)
+                std::fprintf(stderr, " %s", v.name);
+            std::fprintf(stderr, "\n");
+            return 2;
+        }
+    }
+
+    // As in the audio callback
+    denormals::ScopedNoDenormals noDenormals;
+
+    const size_t      samples = static_cast<size_t>(seconds * fs);
+    std::vector<Case> corpus;
+    corpus.push_back({ "guitar", signals::GuitarDI(fs, samples), 250000.0f, 10000.0f });
+    corpus.push_back({ "sine1k", signals::Sine(fs, samples, 1000.0, 0.5f), 500000.0f, 20000.0f });
+    corpus.push_back({ "sweep", signals::Sweep(fs, samples, 20.0, 20000.0, 0.25f), 50000.0f, 5000.0f });
+    corpus.push_back({ "noise", signals::Noise(samples, 0.1f), 250000.0f, 10000.0f });
+
+    const Controls ctl = MakeControls(samples, fs);
+
+    // One reference render per signal and kind of control, timed on the static one
+    std::map<std::pair<size_t, Control>, std::vector<double>> refs;
+    double                                                    refSeconds = 0.0;
+    for(size_t c = 0; c < corpus.size(); ++c)
+    {
+        for(Control control : { Control::Static, Control::Glide, Control::Modulated })
+        {
+            const double s = RenderReference(corpus[c], control, ctl, fs, refs[{ c, control }]);
+            if(control == Control::Static)
+                refSeconds += s;
+        }
+    }
+    const double refNs = 1e9 * refSeconds / static_cast<double>(samples * corpus.size());
+
+    std::printf("%.0f Hz, %.1f s per signal, blocks of %zu; reference %.1f ns/sample\n\n", fs, seconds, kBlockSize,
+                refNs);
+    std::printf("%-12s %-7s %9s %9s %9s %9s %9s %8s\n", "variant", "signal", "max abs", "rms", "null", "spectral",
+                "ns/smp", "speed-up");
+
+    bool allOk = true;
+    for(const Variant& v : variants)
+    {
+        if(!filter.empty() && std::string(v.name).find(filter) == std::string::npos)
+            continue;
+
+        Result worst { -1e9, -1e9, -1e9, 0.0 };
+        for(size_t c = 0; c < corpus.size(); ++c)
+        {
+            std::vector<float> out;
+            double             best = 1e30;
+            for(int r = 0; r < runs; ++r)
+                best = std::min(best, RenderVariant(corpus[c], v, ctl, fs, out));
+
+            const Result res = Compare(out, refs[{ c, v.control }], fs);
+            const double ns  = 1e9 * best / static_cast<double>(samples);
+            std::printf("%-12s %-7s %9.1f %9.1f %9.1f %9.3f %9.1f %7.1fx\n", v.name, corpus[c].name, res.maxAbsDb,
+                        res.rmsDb, res.nullDb, res.spectralDb, ns, refNs / ns);
+
+            worst.maxAbsDb   = std::max(worst.maxAbsDb, res.maxAbsDb);
+            worst.rmsDb      = std::max(worst.rmsDb, res.rmsDb);
+            worst.nullDb     = std::max(worst.nullDb, res.nullDb);
+            worst.spectralDb = std::max(worst.spectralDb, res.spectralDb);
+        }
+
+        const bool ok = worst.maxAbsDb <= v.budget.maxAbsDb && worst.nullDb <= v.budget.nullDb
+                        && worst.spectralDb <= v.budget.spectralDb;
+        allOk = allOk && ok;
+        std::printf("%-12s %-7s %9.1f %9s %9.1f %9.3f   budget %.1f / %.1f / %.2f: %s\n\n", v.name, "worst",
+                    worst.maxAbsDb, "", worst.nullDb, worst.spectralDb, v.budget.maxAbsDb, v.budget.nullDb,
+                    v.budget.spectralDb, ok ? "ok" : "OVER BUDGET");
+    }
+
+    std::printf("%s\n", allOk ? "all variants within budget" : "FAILED: variants over budget");
+    return allOk ? 0 : 1;
+}
@@ -0,0 +1,504 @@
+/*
+ * ts_aliasing.cpp - harmonic distortion and aliasing of the clipper, against CPU cost
+ *
+ *   ts_aliasing [--rate hz] [--level dBFS] [--spec dBc] [--csv file] [--detail] [--quick]
+ *
+ * Drives a set of configurations with stepped sines and an exponential sine sweep at several
+ * drive settings, and splits the output spectrum into harmonic energy (multiples of the
+ * input frequency below Nyquist) and inharmonic energy (everything else, which for a
+ * memoryless-ish clipper is aliasing: harmonics above Nyquist folded back into the band).
+ *
+ * Configurations, each with the Good and the Best diode pair equation:
+ *
+ *   shipped   TubeScreamer as the firmware runs it: Oversampler2x (zero-order hold, the
+ *             clipper on the held sample, [1 2 1] / 4 decimator)
+ *   1x        ClippingStage and the tone RC at the base rate, no filters
+ *   2x 4x 8x  ClippingStage and the tone RC at L times the rate, with windowed-sinc
+ *             polyphase interpolation and decimation (48 L + 1 taps, Kaiser, cutoff
+ *             0.458 fs) - what a real oversampler of that factor would buy
+ *
+ * Stepped sines are coherent (an odd number of cycles in the FFT length, analysed after the
+ * chain has settled, rectangular window), so every harmonic and every alias lands on its own
+ * bin and no window leakage limits the floor. The sweep is analysed frame by frame with a
+ * Blackman-Harris window around the known instantaneous frequency.
+ *
+ * Per configuration prints the cost (ns per base-rate sample), THD at 1 kHz, and the worst
+ * and mean in-band alias level (inharmonic energy within 20 Hz..20 kHz relative to the
+ * fundamental, dBc) over all tones and drives, and the alias level over the sweep (relative
+ * to its harmonic energy). With --spec, names the cheapest configuration whose worst case
+ * meets it. --csv writes every tone for plotting; --detail prints them.
+ *
+ * Build: make -C host (see host/Makefile)
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Denormals.h"
+#include "RCFilter.h"
+#include "Spectrum.h"
+#include "TSClipping.h"
+#include "TestSignals.h"
+#include "TubeScreamer.h"
+
+namespace {
+
+using Clock   = std::chrono::steady_clock;
+using Quality = chowdsp::wdft::DiodeQuality;
+
+constexpr float  kToneR = 10000.0f;
+constexpr float  kToneC = 47e-9f;
+constexpr double kBandLo = 20.0;
+constexpr double kBandHi = 20000.0;
+
+/** One way of running the clipper; process() runs at the base rate. */
+class Config
+{
+  public:
+    virtual ~Config() = default;
+    virtual void prepare(float sampleRate, float drive)              = 0;
+    virtual void process(const float* input, float* output, size_t n) = 0;
+};
+
+template <Quality Q>
+class Shipped final : public Config
+{
+  public:
+    void prepare(float sampleRate, float drive) override
+    {
+        ts = std::make_unique<TubeScreamerT<Q>>();
+        ts->prepare(sampleRate);
+        ts->setGain(drive);
+        ts->setTone(kToneR, kToneC);
+        ts->setIdleThreshold(0.0f);
+    }
+
+    void process(const float* input, float* output, size_t n) override { ts->processBlock(input, output, n); }
+
+  private:
+    std::unique_ptr<TubeScreamerT<Q>> ts;
+};
+
+/** Windowed-sinc lowpass (Kaiser) for a factor-L resampler, unity DC gain. */
+std::vector<float> DesignLowpass(size_t factor)
+{
+    const size_t taps   = 48 * factor + 1;
+    const double cutoff = 0.458 / static_cast<double>(factor); // cycles per high-rate sample
+    const double beta   = 8.6;                                  // about 86 dB stopband
+
+    auto bessel0 = [](double x) {
+        double sum = 1.0, term = 1.0;
+        for(int k = 1; k < 50; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+        return sum;
+    };
+
+    std::vector<double> h(taps);
+    double              sum    = 0.0;
+    const double        centre = static_cast<double>(taps - 1) / 2.0;
+    for(size_t i = 0; i < taps; ++i)
+    {
+        const double t    = static_cast<double>(i) - centre;
+        const double sinc = t == 0.0 ? 2.0 * cutoff : std::sin(2.0 * signals::kPi * cutoff * t) / (signals::kPi * t);
+        const double r    = t / centre;
+        h[i]              = sinc * bessel0(beta * std::sqrt(std::max(0.0, 1.0 - r * r))) / bessel0(beta);
+        sum += h[i];
+    }
+
+    std::vector<float> out(taps);
+    for(size_t i = 0; i < taps; ++i)
+        out[i] = static_cast<float>(h[i] / sum);
+    return out;
+}
+
+/** Delay line read as a contiguous block: every sample is written twice, len apart. */
+class History
+{
+  public:
+    void resize(size_t length)
+    {
+        len = length;
+        buf.assign(2 * length, 0.0f);
+        pos = 0;
+    }
+
+    void push(float x)
+    {
+        pos            = (pos == 0 ? len : pos) - 1;
+        buf[pos]       = x;
+        buf[pos + len] = x;
+    }
+
+    const float* newestFirst() const { return &buf[pos]; }
+
+  private:
+    std::vector<float> buf;
+    size_t             len = 0;
+    size_t             pos = 0;
+};
+
+template <Quality Q>
+class Oversampled final : public Config
+{
+  public:
+    explicit Oversampled(size_t factor) : factor(factor) {}
+
+    void prepare(float sampleRate, float drive) override
+    {
+        clip = std::make_unique<ClippingStageT<Q>>();
+        tone = std::make_unique<RCFilter>(kToneR, kToneC);
+        clip->prepare(sampleRate * static_cast<float>(factor));
+        clip->setDrive(drive);
+        tone->prepare(sampleRate * static_cast<float>(factor));
+
+        if(factor > 1)
+        {
+            h = DesignLowpass(factor);
+            phaseTaps = (h.size() + factor - 1) / factor;
+            upHistory.resize(phaseTaps);
+            downHistory.resize(h.size());
+        }
+    }
+
+    void process(const float* input, float* output, size_t n) override
+    {
+        if(factor == 1)
+        {
+            for(size_t i = 0; i < n; ++i)
+                output[i] = tone->processSample(clip->processSample(input[i]));
+            return;
+        }
+
+        const float gain = static_cast<float>(factor); // zero stuffing leaves 1/L of the level
+        for(size_t i = 0; i < n; ++i)
+        {
+            upHistory.push(input[i]);
+            const float* x = upHistory.newestFirst();
+            for(size_t p = 0; p < factor; ++p)
+            {
+                // Polyphase interpolation: phase p uses taps p, p + L, p + 2L, ...
+                float up = 0.0f;
+                for(size_t j = 0, k = p; k < h.size(); ++j, k += factor)
+                    up += h[k] * x[j];
+                downHistory.push(tone->processSample(clip->processSample(gain * up)));
+            }
+
+            // Decimation: one output per L high-rate samples
+            const float* y   = downHistory.newestFirst();
+            float        acc = 0.0f;
+            for(size_t k = 0; k < h.size(); ++k)
+                acc += h[k] * y[k];
+            output[i] = acc;
+        }
+    }
+
+  private:
+    size_t                             factor;
+    std::unique_ptr<ClippingStageT<Q>> clip;
+    std::unique_ptr<RCFilter>          tone;
+    std::vector<float>                 h;
+    size_t                             phaseTaps = 0;
+    History                            upHistory;
+    History                            downHistory;
+};
+
+struct Entry
+{
+    Entry(std::string name, std::unique_ptr<Config> config) : name(std::move(name)), config(std::move(config)) {}
+
+    std::string             name;
+    std::unique_ptr<Config> config;
+
+    double seconds = 0.0; // processing time over all renders
+    size_t samples = 0;
+
+    double thd1k       = -999.0; // at the middle drive
+    double worstAlias  = -999.0;
+    double aliasSum    = 0.0;
+    size_t tones       = 0;
+    double sweepAlias  = -999.0;
+    std::vector<double> sweepOctaves; // alias dB per input octave from 20 Hz, NaN if not measurable
+
+    double NsPerSample() const { return samples > 0 ? 1e9 * seconds / static_cast<double>(samples) : 0.0; }
+};
+
+double Db10(double ratio)
+{
+    return 10.0 * std::log10(std::max(ratio, 1e-30));
+}
+
+void Render(Entry& e, float fs, float drive, const std::vector<float>& in, std::vector<float>& out)
+{
+    e.config->prepare(fs, drive);
+    out.assign(in.size(), 0.0f);
+
+    const size_t block = 48;
+    const auto   t0    = Clock::now();
+    for(size_t start = 0; start < in.size(); start += block)
+        e.config->process(&in[start], &out[start], std::min(block, in.size() - start));
+    e.seconds += std::chrono::duration<double>(Clock::now() - t0).count();
+    e.samples += in.size();
+}
+
+struct ToneResult
+{
+    double f0;
+    double thdDb;
+    double aliasDb;
+};
+
+/** Coherent sine: cycles (odd) periods in fftSize samples, analysed after settle samples. */
+ToneResult AnalyseTone(Entry& e, float fs, float drive, float amplitude, size_t cycles, size_t fftSize,
+                       size_t settle)
+{
+    const double       f0 = static_cast<double>(cycles) * fs / static_cast<double>(fftSize);
+    std::vector<float> in = signals::Sine(fs, settle + fftSize, f0, amplitude);
+    std::vector<float> out;
+    Render(e, fs, drive, in, out);
+
+    const std::vector<double> p = spectrum::FramePower(out.data() + settle, fftSize);
+
+    const double binHz = fs / static_cast<double>(fftSize);
+    const size_t lo    = static_cast<size_t>(std::ceil(kBandLo / binHz));
+    const size_t hi    = std::min(p.size() - 1, static_cast<size_t>(kBandHi / binHz));
+
+    double harmonics = 0.0;
+    double alias     = 0.0;
+    for(size_t k = 1; k < p.size(); ++k)
+    {
+        const bool harmonic = (k % cycles) == 0;
+        if(harmonic && k > cycles)
+            harmonics += p[k];
+        else if(!harmonic && k >= lo && k <= hi)
+            alias += p[k];
+    }
+
+    const double fundamental = p[cycles];
+    return { f0, Db10(harmonics / fundamental), Db10(alias / fundamental) };
+}
+
+/** Exponential sweep, framed; returns the overall alias level and one per input octave. */
+void AnalyseSweep(Entry& e, float fs, float drive, float amplitude, double seconds)
+{
+    const double f0 = 20.0, f1 = 20000.0;
+    const size_t n  = static_cast<size_t>(seconds * fs);
+
+    std::vector<float> in = signals::Sweep(fs, n, f0, f1, amplitude);
+    std::vector<float> out;
+    Render(e, fs, drive, in, out);
+
+    const size_t        frame = 2048;
+    const size_t        hop   = 512;
+    const double        binHz = fs / static_cast<double>(frame);
+    std::vector<double> window(frame);
+    for(size_t i = 0; i < frame; ++i)
+    {
+        // 4-term Blackman-Harris: sidelobes below -92 dB, main lobe +-4 bins
+        const double x = 2.0 * signals::kPi * static_cast<double>(i) / static_cast<double>(frame);
+        window[i]      = 0.35875 - 0.48829 * std::cos(x) + 0.14128 * std::cos(2.0 * x) - 0.01168 * std::cos(3.0 * x);
+    }
+
+    const size_t        octaves = 10;
+    std::vector<double> octHarm(octaves, 0.0), octAlias(octaves, 0.0);
+    std::vector<size_t> octBins(octaves, 0), octFree(octaves, 0); // in-band bins, and those not masked
+    double              harm = 0.0, alias = 0.0;
+
+    std::vector<std::complex<double>> buf(frame);
+    for(size_t start = 0; start + frame <= n; start += hop)
+    {
+        const double fa = f0 * std::exp(static_cast<double>(start) / n * std::log(f1 / f0));
+        const double fb = f0 * std::exp(static_cast<double>(start + frame) / n * std::log(f1 / f0));
+        for(size_t i = 0; i < frame; ++i)
+            buf[i] = static_cast<double>(out[start + i]) * window[i];
+        spectrum::FFT(buf);
+
+        // Bins within reach of some harmonic's track through this frame, plus the main lobe
+        std::vector<bool> isHarmonic(frame / 2 + 1, false);
+        for(size_t m = 1; m * fa < fs / 2.0; ++m)
+        {
+            const double lo = m * fa / binHz - 5.0;
+            const double hi = m * fb / binHz + 5.0;
+            for(double k = std::max(0.0, std::floor(lo)); k <= std::min(hi, static_cast<double>(frame / 2)); k += 1.0)
+                isHarmonic[static_cast<size_t>(k)] = true;
+        }
+
+        const size_t oct = std::min(octaves - 1, static_cast<size_t>(std::log2(std::sqrt(fa * fb) / f0)));
+
+        double fh = 0.0, fa2 = 0.0;
+        for(size_t k = 1; k <= frame / 2; ++k)
+        {
+            const double f      = k * binHz;
+            const bool   inBand = f >= kBandLo && f <= kBandHi;
+            octBins[oct] += inBand;
+            if(isHarmonic[k])
+                fh += std::norm(buf[k]);
+            else if(inBand)
+            {
+                fa2 += std::norm(buf[k]);
+                ++octFree[oct];
+            }
+        }
+        harm += fh;
+        alias += fa2;
+        octHarm[oct] += fh;
+        octAlias[oct] += fa2;
+    }
+
+    e.sweepAlias = std::max(e.sweepAlias, Db10(alias / harm));
+    // Low notes have harmonics every few bins and leave nothing to measure between them:
+    // such octaves stay NaN (printed as "-")
+    e.sweepOctaves.resize(octaves, std::nan(""));
+    for(size_t o = 0; o < octaves; ++o)
+    {
+        if(octHarm[o] <= 0.0 || octFree[o] * 10 < octBins[o])
+            continue;
+        const double db   = Db10(octAlias[o] / octHarm[o]);
+        e.sweepOctaves[o] = std::isnan(e.sweepOctaves[o]) ? db : std::max(e.sweepOctaves[o], db);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    float       fs      = 48000.0f;
+    double      levelDb = -12.0;
+    double      spec    = 0.0;
+    bool        hasSpec = false;
+    bool        detail  = false;
+    bool        quick   = false;
+    std::string csvPath;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        const std::string arg     = argv[i];
+        const bool        hasNext = i + 1 < argc;
+        if(arg == "--rate" && hasNext)
+            fs = std::strtof(argv[++i], nullptr);
+        else if(arg == "--level" && hasNext)
+            levelDb = std::strtod(argv[++i], nullptr);
+        else if(arg == "--spec" && hasNext)
+        {
+            spec    = std::strtod(argv[++i], nullptr);
+            hasSpec = true;
+        }
+        else if(arg == "--csv" && hasNext)
+            csvPath = argv[++i];
+        else if(arg == "--detail")
+            detail = true;
+        else if(arg == "--quick")
+            quick = true;
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--rate hz] [--level dBFS] [--spec dBc] [--csv file] [--detail] [--quick]\n",
+                         argv[0]);
+            return 2;
+        }
+    }
+
+    denormals::ScopedNoDenormals noDenormals;
+
+    const float  amplitude = static_cast<float>(std::pow(10.0, levelDb / 20.0));
+    const size_t fftSize   = quick ? 16384 : 65536;
+    const size_t settle    = static_cast<size_t>(0.25 * fs);
+    const double sweepSecs = quick ? 4.0 : 10.0;
+
+    const std::vector<double> freqs  = quick ? std::vector<double> { 1000.0, 4000.0 }
+                                             : std::vector<double> { 100.0, 250.0, 500.0, 1000.0, 2000.0, 4000.0,
+                                                                    7000.0, 10000.0 };
+    const std::vector<float>  drives = { 10000.0f, 100000.0f, 500000.0f };
+
+    std::vector<Entry> entries;
+    auto addConfigs = [&entries](auto quality, const std::string& suffix) {
+        constexpr Quality q = decltype(quality)::value;
+        entries.emplace_back("shipped" + suffix, std::make_unique<Shipped<q>>());
+        for(size_t factor : { 1, 2, 4, 8 })
+            entries.emplace_back(std::to_string(factor) + "x" + suffix, std::make_unique<Oversampled<q>>(factor));
+    };
+    addConfigs(std::integral_constant<Quality, Quality::Good> {}, "/good");
+    addConfigs(std::integral_constant<Quality, Quality::Best> {}, "/best");
+
+    FILE* csv = nullptr;
+    if(!csvPath.empty())
+    {
+        csv = std::fopen(csvPath.c_str(), "w");
+        if(csv == nullptr)
+        {
+            std::fprintf(stderr, "cannot write %s\n", csvPath.c_str());
+            return 1;
+        }
+        std::fprintf(csv, "config,drive,f0,thd_db,alias_dbc\n");
+    }
+
+    std::printf("%.0f Hz, level %.1f dBFS, drives 10k / 100k / 500k, %zu tones, %.0f s sweep\n\n", fs, levelDb,
+                freqs.size(), sweepSecs);
+
+    for(Entry& e : entries)
+    {
+        for(float drive : drives)
+        {
+            for(double f : freqs)
+            {
+                const size_t     cycles = static_cast<size_t>(std::round(f * fftSize / fs)) | 1; // odd: no alias on a harmonic
+                const ToneResult r      = AnalyseTone(e, fs, drive, amplitude, cycles, fftSize, settle);
+                e.worstAlias            = std::max(e.worstAlias, r.aliasDb);
+                e.aliasSum += r.aliasDb;
+                ++e.tones;
+                if(drive == drives[1] && f == 1000.0)
+                    e.thd1k = r.thdDb;
+                if(detail)
+                    std::printf("  %-12s drive %6.0f  %8.1f Hz  THD %7.1f dB  alias %7.1f dBc\n", e.name.c_str(), drive,
+                                r.f0, r.thdDb, r.aliasDb);
+                if(csv != nullptr)
+                    std::fprintf(csv, "%s,%.0f,%.2f,%.2f,%.2f\n", e.name.c_str(), drive, r.f0, r.thdDb, r.aliasDb);
+            }
+            AnalyseSweep(e, fs, drive, amplitude, sweepSecs);
+        }
+        if(detail)
+        {
+            std::printf("  %-12s sweep alias per octave from 20 Hz:", e.name.c_str());
+            for(double o : e.sweepOctaves)
+            {
+                if(std::isnan(o))
+                    std::printf(" -");
+                else
+                    std::printf(" %.0f", o);
+            }
+            std::printf("\n\n");
+        }
+    }
+    if(csv != nullptr)
+        std::fclose(csv);
+
+    std::printf("%-13s %8s %10s %12s %11s %12s\n", "config", "ns/smp", "THD 1k", "alias worst", "alias mean",
+                "sweep alias");
+    for(const Entry& e : entries)
+        std::printf("%-13s %8.1f %7.1f dB %8.1f dBc %7.1f dBc %9.1f dB\n", e.name.c_str(), e.NsPerSample(), e.thd1k,
+                    e.worstAlias, e.aliasSum / static_cast<double>(e.tones), e.sweepAlias);
+
+    if(hasSpec)
+    {
+        const Entry* best = nullptr;
+        for(const Entry& e : entries)
+            if(e.worstAlias <= spec && e.sweepAlias <= spec && (best == nullptr || e.NsPerSample() < best->NsPerSample()))
+                best = &e;
+        if(best != nullptr)
+            std::printf("\ncheapest configuration with aliasing <= %.1f dBc: %s (%.1f ns/sample)\n", spec,
+                        best->name.c_str(), best->NsPerSample());
+        else
+            std::printf("\nno configuration keeps aliasing <= %.1f dBc\n", spec);
+        return best != nullptr ? 0 : 1;
+    }
+    return 0;
+}
@@ -0,0 +1,270 @@
+/*
+ * ts_render.cpp - offline renderer: streams a WAV file through the pedal model
+ *
+ *   ts_render [options] in.wav out.wav
+ *   ts_render [options] --batch outdir in1.wav in2.wav ...
+ *   ts_render [options] --parallel [--verify] in.wav out.wav
+ *     --drive ohms        drive pot resistance, 0..500000 (default 250000)
+ *     --tone ohms         tone resistor, 1000..20000 (default 10000)
+ *     --tone-c farads     tone capacitor (default 47e-9)
+ *     --pre gain          pre-gain (default 1)
+ *     --post gain         post-gain (default 1)
+ *     --preset file name  take the settings above from a preset file (host/PresetFile.h)
+ *     --auto spec         automation, e.g. --auto drive=0:10,2:500000 (seconds:value, linear);
+ *                         repeat for several params (drive, tone, pre, post)
+ *     --format f          output int16 | int24 | int32 | float (default: same as the input)
+ *     --block frames      frames per processBlock() call (default 64)
+ *     --chunk frames      frames per file read/write (default 4096)
+ *     --mmap              memory-map the input (WAV or RF64) instead of buffered reads
+ *     --raw ch rate       input is headerless float32 with ch channels at rate Hz (implies --mmap)
+ *     --batch outdir      render every input file to outdir/<same name>, in parallel
+ *     --jobs n            batch worker threads (default: one per hardware thread)
+ *     --pin               pin batch workers to CPUs (Linux)
+ *     --parallel          split one file into segments rendered in parallel (uses --jobs, --pin)
+ *     --segment seconds   segment length (default: about four segments per worker)
+ *     --preroll ms        warm-up per segment (default: derived from the slowest time constant)
+ *     --verify            also render serially and report the largest deviation
+ *
+ * Each channel runs through its own chain. Prints the realtime factor of the whole render
+ * and of the DSP alone; in batch mode per file and for the whole batch.
+ *
+ * Build: make -C host (see host/Makefile)
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "PresetFile.h"
+#include "Render.h"
+
+namespace {
+
+void Usage(const char* argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s [--drive ohms] [--tone ohms] [--tone-c farads] [--pre g] [--post g]\n"
+                 "          [--preset file name] [--auto param=t:v,...] [--format int16|int24|int32|float]\n"
+                 "          [--block frames] [--chunk frames] [--mmap] [--raw ch rate] in.wav out.wav\n"
+                 "       %s [options] [--jobs n] [--pin] --batch outdir in.wav...\n"
+                 "       %s [options] [--jobs n] [--pin] [--segment s] [--preroll ms] [--verify] --parallel in.wav out.wav\n",
+                 argv0, argv0, argv0);
+}
+
+bool ApplyPreset(const std::string& path, const std::string& name, render::Settings& s, std::string* error)
+{
+    std::vector<presets::NamedPreset> list;
+    if(!presets::ReadPresetFile(path, list, error))
+        return false;
+    for(const presets::NamedPreset& p : list)
+    {
+        if(p.name == name)
+        {
+            s.drive    = p.params.drive;
+            s.tone     = p.params.toneR;
+            s.toneC    = p.params.toneC;
+            s.preGain  = p.params.preGain;
+            s.postGain = p.params.postGain;
+            return true;
+        }
+    }
+    *error = path + ": no preset named '" + name + "'";
+    return false;
+}
+
+int RenderBatch(const std::vector<std::string>& files, const std::string& outDir, const render::Settings& settings,
+                const tasks::PoolOptions& pool)
+{
+    std::vector<render::BatchItem> items(files.size());
+    std::set<std::string>          names;
+    for(size_t i = 0; i < files.size(); ++i)
+    {
+        const std::string name = std::filesystem::path(files[i]).filename().string();
+        if(!names.insert(name).second)
+        {
+            std::fprintf(stderr, "%s: more than one input named %s\n", outDir.c_str(), name.c_str());
+            return 2;
+        }
+        items[i].in  = files[i];
+        items[i].out = (std::filesystem::path(outDir) / name).string();
+    }
+
+    render::BatchStats stats;
+    render::RenderBatch(items, settings, pool, stats);
+
+    for(const render::BatchItem& item : items)
+    {
+        if(!item.ok)
+            std::printf("%-40s  FAILED: %s\n", item.in.c_str(), item.error.c_str());
+        else
+            std::printf("%-40s  %8.2f s audio  %7.3f s  %7.1fx  (worker %zu)\n", item.in.c_str(),
+                        item.stats.audioSeconds, item.stats.wallSeconds, item.stats.RealtimeFactor(), item.worker);
+    }
+    std::printf("%zu files (%zu failed), %.1f s of audio in %.3f s on %zu threads: %.1fx realtime\n", stats.files,
+                stats.failed, stats.audioSeconds, stats.wallSeconds, stats.threads, stats.RealtimeFactor());
+    return stats.failed > 0 ? 1 : 0;
+}
+
+int RenderParallel(const std::string& in, const std::string& out, const render::Settings& settings,
+                   const render::SegmentOptions& options, bool verify)
+{
+    render::Stats         stats;
+    render::SegmentReport report;
+    std::string           error;
+    if(!render::RenderSegmented(in, out, settings, options, stats, report, &error))
+    {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    const double fs = static_cast<double>(stats.frames) / stats.audioSeconds;
+    std::printf("%s: %llu frames x %zu ch, %.2f s of audio\n", in.c_str(), static_cast<unsigned long long>(stats.frames),
+                stats.channels, stats.audioSeconds);
+    std::printf("  %zu segments of %.2f s, pre-roll %.1f ms (slowest time constant %.2f ms)\n", report.segments,
+                report.segmentFrames / fs, 1e3 * report.prerollFrames / fs, 1e3 * report.timeConstant);
+    std::printf("  wall %.3f s  realtime factor %.1fx  (DSP %.3f s over all threads)\n", stats.wallSeconds,
+                stats.RealtimeFactor(), stats.dspSeconds);
+    if(!verify)
+        return 0;
+
+    const std::string reference = out + ".serial.wav";
+    render::Stats     serial;
+    render::Deviation deviation;
+    const bool        ok = render::RenderFile(in, reference, settings, serial, &error)
+                    && render::CompareFiles(out, reference, deviation, &error);
+    std::remove(reference.c_str());
+    if(!ok)
+    {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    const double seg = static_cast<double>(deviation.frame) / report.segmentFrames;
+    std::printf("  serial %.3f s: max deviation %.3g (%.1f dBFS) at frame %llu ch %zu (%.3f segments in)\n",
+                serial.wallSeconds, deviation.maxAbs,
+                deviation.maxAbs > 0.0 ? 20.0 * std::log10(deviation.maxAbs) : -INFINITY,
+                static_cast<unsigned long long>(deviation.frame), deviation.channel, seg);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    render::Settings         settings;
+    tasks::PoolOptions       pool;
+    render::SegmentOptions   segmentOptions;
+    bool                     parallel = false;
+    bool                     verify   = false;
+    std::string              batchDir;
+    std::vector<std::string> files;
+    std::string              error;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        const std::string arg     = argv[i];
+        const bool        hasNext = i + 1 < argc;
+        if(arg == "--drive" && hasNext)
+            settings.drive = std::strtof(argv[++i], nullptr);
+        else if(arg == "--tone" && hasNext)
+            settings.tone = std::strtof(argv[++i], nullptr);
+        else if(arg == "--tone-c" && hasNext)
+            settings.toneC = std::strtof(argv[++i], nullptr);
+        else if(arg == "--pre" && hasNext)
+            settings.preGain = std::strtof(argv[++i], nullptr);
+        else if(arg == "--post" && hasNext)
+            settings.postGain = std::strtof(argv[++i], nullptr);
+        else if(arg == "--preset" && i + 2 < argc)
+        {
+            const std::string path = argv[++i];
+            const std::string name = argv[++i];
+            if(!ApplyPreset(path, name, settings, &error))
+            {
+                std::fprintf(stderr, "%s\n", error.c_str());
+                return 1;
+            }
+        }
+        else if(arg == "--auto" && hasNext)
+        {
+            render::Automation a;
+            if(!render::ParseAutomation(argv[++i], a, &error))
+            {
+                std::fprintf(stderr, "%s\n", error.c_str());
+                return 2;
+            }
+            settings.automation.push_back(a);
+        }
+        else if(arg == "--format" && hasNext)
+        {
+            if(!wav::ParseFormat(argv[++i], settings.format))
+            {
+                Usage(argv[0]);
+                return 2;
+            }
+            settings.keepFormat = false;
+        }
+        else if(arg == "--block" && hasNext)
+            settings.blockSize = static_cast<size_t>(std::atoi(argv[++i]));
+        else if(arg == "--chunk" && hasNext)
+            settings.chunkFrames = static_cast<size_t>(std::atoi(argv[++i]));
+        else if(arg == "--mmap")
+            settings.mapInput = true;
+        else if(arg == "--raw" && i + 2 < argc)
+        {
+            settings.rawChannels   = static_cast<size_t>(std::atoi(argv[++i]));
+            settings.rawSampleRate = std::strtof(argv[++i], nullptr);
+        }
+        else if(arg == "--batch" && hasNext)
+            batchDir = argv[++i];
+        else if(arg == "--jobs" && hasNext)
+            pool.threads = static_cast<size_t>(std::atoi(argv[++i]));
+        else if(arg == "--pin")
+            pool.pin = true;
+        else if(arg == "--parallel")
+            parallel = true;
+        else if(arg == "--segment" && hasNext)
+            segmentOptions.segmentSeconds = std::strtod(argv[++i], nullptr);
+        else if(arg == "--preroll" && hasNext)
+            segmentOptions.prerollSeconds = 0.001 * std::strtod(argv[++i], nullptr);
+        else if(arg == "--verify")
+            verify = true;
+        else if(arg[0] != '-')
+            files.push_back(arg);
+        else
+        {
+            Usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if(settings.blockSize == 0 || settings.chunkFrames == 0 || (batchDir.empty() ? files.size() != 2 : files.empty()))
+    {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    if(!batchDir.empty())
+        return RenderBatch(files, batchDir, settings, pool);
+    if(parallel)
+    {
+        segmentOptions.pool = pool;
+        return RenderParallel(files[0], files[1], settings, segmentOptions, verify);
+    }
+
+    render::Stats stats;
+    if(!render::RenderFile(files[0], files[1], settings, stats, &error))
+    {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    std::printf("%s: %llu frames x %zu ch, %.2f s of audio\n", files[0].c_str(),
+                static_cast<unsigned long long>(stats.frames), stats.channels, stats.audioSeconds);
+    std::printf("  wall %.3f s  realtime factor %.1fx  (DSP only %.3f s, %.1fx)\n", stats.wallSeconds,
+                stats.RealtimeFactor(), stats.dspSeconds, stats.DspRealtimeFactor());
+    return 0;
+}
@@ -6,7 +6,16 @@
 #include "daisysp.h"
 #include "daisy_core.h"
 #include "TubeScreamer.h"
+#include "Bypass.h"
+#include "ParamChannel.h"
+#include "Presets.h"
+#include "QspiPresetStorage.h"
 #include "Controls.h"
+#include "BlockSizeTuner.h"
+#include "Denormals.h"
+#include "LoadMeter.h"
+#include "StageProfiler.h"
+#include "Telemetry.h"
 
 using namespace daisy;
 using namespace daisysp;
@@ -16,6 +25,7 @@ using controls::Controls;
 
 DaisySeed hw;
 TubeScreamer ts;
+Bypass bypass;
 
 // 6 pots on A(1-6); 4 SPST toggle on D(7-10); 2 momentary footswitches on D25 & D26
 constexpr size_t kNPots = 6, kNToggles = 4, kNFoots = 2, kNLeds = 2;
@@ -23,62 +33,378 @@ Controls <kNPots, kNToggles, kNFoots, kNLeds> ui;
 
 float sampleRate;
 
+// Block size is set from the Makefile (AUDIO_BLOCK_SIZE); the DSP itself handles any size.
+#ifndef TS_AUDIO_BLOCK_SIZE
+#define TS_AUDIO_BLOCK_SIZE 4
+#endif
+#ifndef TS_CALIBRATE_BLOCK_SIZE
+#define TS_CALIBRATE_BLOCK_SIZE 0
+#endif
+#ifndef TS_OVERLOAD_LED
+#define TS_OVERLOAD_LED 0
+#endif
 
-void AudioCallback(AudioHandle::InterleavingInputBuffer in, 
-                   AudioHandle::InterleavingOutputBuffer out, 
-                   size_t size)
+constexpr size_t kMaxBlockSize = 64;
+constexpr size_t kAudioBlockSize = TS_AUDIO_BLOCK_SIZE;
+static_assert(kAudioBlockSize >= 1 && kAudioBlockSize <= kMaxBlockSize, "AUDIO_BLOCK_SIZE must be 1..64");
+
+// Calibration: max callback load allowed and how long each candidate block size is measured
+constexpr float    kCalibrationTargetLoad = 0.7f;
+constexpr uint32_t kCalibrationSettleMs   = 200;
+constexpr uint32_t kCalibrationMeasureMs  = 1000;
+
+// DSP load of AudioCallback; the main loop polls it, and blinks LED 2 on overload if enabled
+load::LoadMeter    loadMeter;
+load::LoadStats    dspLoad;
+constexpr uint32_t kLoadPollMs      = 100;
+constexpr float    kOverloadLoad    = 0.9f; // decaying peak, fraction of the block period
+constexpr uint32_t kOverloadBlinkMs = 125;
+
+// Audio callback -> main loop: overruns, parameter changes, clipping, NaN/Inf (Telemetry.h)
+telemetry::Ring<>  telemetryRing;
+constexpr uint32_t kTelemetryLoadMs     = 1000; // peak load reported once per period
+uint32_t           telemetryLoadStartMs = 0;
+float              telemetryPeakLoad    = 0.0f;
+
+float dryBuf[kMaxBlockSize]; // de-interleaved right channel
+float wetBuf[kMaxBlockSize]; // processed right channel, crossfaded with dryBuf by the bypass
+
+// Controls are polled from the main loop at this rate, never from the audio interrupt
+constexpr float    kControlRateHz   = 1000.0f;
+constexpr uint32_t kControlPeriodMs = 1;
+constexpr uint32_t kAliveBlinkMs    = 500;
+constexpr float    kPotRateHz       = kControlRateHz / kNPots; // ~167 Hz: one pot per poll, in turn
+constexpr float    kSwitchRateHz    = 500.0f;                  // every other poll
+
+/** Continuous parameters, published by the main loop as one immutable snapshot. */
+struct DspParams
 {
+    float gain;     // drive pot resistance in ohms
+    float rTone;    // tone resistor in ohms
+    float preGain;
+    float postGain;
+};
 
-     // Update controls once per block
-    ui.Update();
+/** Discrete changes, queued so none is lost between two audio blocks. */
+struct DspEvent
+{
+    enum class Type : uint8_t { SetEffectOn, RecallPreset };
+    Type  type;
+    float value;
+};
+
+// Main loop -> audio interrupt, consumed once per block
+params::ParamChannel<DspParams, DspEvent> dspChannel({ 10.0f, 10000.0f, 1.0f, 1.0f });
+
+bool ledOn = false;
+
+// Footswitch 2 (D26, index 1): tap recalls the next preset, hold stores the current settings in the
+// current slot
+constexpr size_t   kNPresets         = 4;
+constexpr uint32_t kPresetSaveHoldMs = 2000;
+constexpr float    kToneCapacitor    = 47e-9f;
+
+presets::PresetBank<kNPresets> presetBank;
+presets::QspiPresetStorage     presetStorage(hw.qspi);
+size_t                         presetSlot  = 0;
+bool                           presetSaved = false; // the current hold already stored
+
+// What the DSP is running: the last snapshot published, or the last preset recalled since
+DspParams lastParams = { 10.0f, 10000.0f, 1.0f, 1.0f };
+
+/** Fills every slot with the power-up settings, used when the flash holds no valid bank. */
+void InitDefaultPresets()
+{
+    const presets::PresetParams defaults = { lastParams.gain, lastParams.rTone, kToneCapacitor,
+                                             lastParams.preGain, lastParams.postGain };
+    for (size_t i = 0; i < kNPresets; ++i)
+        presetBank.Store(i, defaults, ts, sampleRate);
+}
+
+/** Main loop: handles tap (recall next) and hold (store + save) on footswitch 2. */
+void UpdatePresets()
+{
+    if(ui.FootPressed(1) && !presetSaved && ui.FootHeldMs(1) >= kPresetSaveHoldMs)
+    {
+        // The audio side copies a slot only when it handles the recall event, so rewriting the
+        // current slot here (seconds after it was recalled) never races with that copy.
+        presetBank.Store(presetSlot,
+                         { lastParams.gain, lastParams.rTone, kToneCapacitor,
+                           lastParams.preGain, lastParams.postGain },
+                         ts, sampleRate);
+        presetBank.Save(presetStorage); // stalls the main loop for the flash erase/program
+        presetSaved = true;
+    }
+
+    if(ui.FootFalling(1))
+    {
+        if(!presetSaved)
+        {
+            const size_t next = (presetSlot + 1) % kNPresets;
+            if(dspChannel.Post({ DspEvent::Type::RecallPreset, static_cast<float>(next) }))
+            {
+                presetSlot = next;
+
+                // A store right after this keeps the recalled sound, not the pot positions
+                const presets::PresetParams& p = presetBank.Get(next)->params;
+                lastParams = { p.drive, p.toneR, p.preGain, p.postGain };
+            }
+        }
+        presetSaved = false;
+    }
+}
 
-    // Toggle bypass via SPST
-    bool on = ui.EffectOn();
+/** Main loop: read the hardware, publish a snapshot for the DSP and drive the LED. */
+void UpdateControls()
+{
+    ui.Update();
 
     // Toggle bypass via momentary footswitch
     if(ui.FootRising(0))
-    {
         ui.EffectToggle();
-        on = ui.EffectOn();
-    }    
-    // Read pots for gain and tone
-    float gain = ui.PotMapped(0, 0.0f, 500000.0f); // Map pot 0 to gain range
-    float rTone = ui.PotMapped(2, 1000.0f, 20000.0f); // Map pot 2 to tone resistor range
-    ts.setTone(rTone, 47e-9f);
 
-    float preGain = ui.PotMapped(3, 0.0f, 1.0f); // Map pot 3 to pre-gain range
-    float postGain = ui.PotMapped(5, 0.0f, 2.0f); // Map pot 5 to post-gain range
+    // Only hand the DSP a new snapshot when a pot really moved; resting pots cost nothing
+    if(ui.PotChanged(0) || ui.PotChanged(2) || ui.PotChanged(3) || ui.PotChanged(5))
+    {
+        DspParams p;
+        p.gain     = ui.PotMapped(0); // gain range
+        p.rTone    = ui.PotMapped(2); // tone resistor range
+        p.preGain  = ui.PotMapped(3); // pre-gain range
+        p.postGain = ui.PotMapped(5); // post-gain range
+        dspChannel.Publish(p);
+        lastParams = p;
+    }
+
+    UpdatePresets();
+
+    // Light LED when not bypassed; the LED and the DSP only hear about actual changes
+    const bool on = ui.EffectOn();
+    if(on != ledOn)
+    {
+        if(dspChannel.Post({ DspEvent::Type::SetEffectOn, on ? 1.0f : 0.0f }))
+        {
+            ui.LedWrite(0, on);
+            ledOn = on; // retried on the next poll if the queue was full
+        }
+    }
+}
+
+// Per-sample glides for the gains; drive and tone are smoothed inside TubeScreamer
+constexpr float kGainRampMs = 5.0f;
+ExpSmoother preGainSmoother;
+ExpSmoother postGainSmoother;
+
+DspParams appliedParams = { 10.0f, 10000.0f, 1.0f, 1.0f }; // audio side: last snapshot taken over
+
+/** Audio side: one Param event for each field of the snapshot that changed. */
+void RecordParamChanges(const DspParams& params, uint32_t now)
+{
+    const float before[] = { appliedParams.gain, appliedParams.rTone, appliedParams.preGain, appliedParams.postGain };
+    const float after[]  = { params.gain, params.rTone, params.preGain, params.postGain };
+    for (uint16_t i = 0; i < 4; ++i)
+        if(after[i] != before[i])
+            telemetryRing.Record({ telemetry::Type::Param, static_cast<uint16_t>(telemetry::kParamGain + i), now,
+                                   after[i] });
+    appliedParams = params;
+}
+
+void AudioCallback(AudioHandle::InterleavingInputBuffer in, 
+                   AudioHandle::InterleavingOutputBuffer out, 
+                   size_t size)
+{
+    loadMeter.OnBlockStart();
+    const uint32_t now   = System::GetNow();
+    uint16_t       clips = 0; // output samples at or over full scale
 
-    for (size_t i = 0; i < size; i += 2)
+    // Pick up the latest control snapshot and events; nothing below touches the hardware
+    if(dspChannel.Consume())
     {
-        if(on)
+        const DspParams& params = dspChannel.Snapshot();
+        RecordParamChanges(params, now);
+        ts.setGainTarget(params.gain);
+        ts.setToneTarget(params.rTone);
+        preGainSmoother.setTarget(params.preGain);
+        postGainSmoother.setTarget(params.postGain);
+    }
+
+    DspEvent event;
+    while(dspChannel.PopEvent(event))
+    {
+        switch(event.type)
         {
-            float x = in[i+1] * preGain;    // Apply pre-gain to the input signal
-            x = ts.processSample(x, gain);  // Process the audio signal through the Tube Screamer
-            out[i + 1] = x * postGain;      // Apply post-gain to the output signal
-            ui.LedWrite(0, on);             // Light LED when not bypassed
+            case DspEvent::Type::SetEffectOn:
+                bypass.setEngaged(event.value > 0.5f);
+                telemetryRing.Record({ telemetry::Type::Param, telemetry::kParamEffectOn, now, event.value });
+                break;
+            case DspEvent::Type::RecallPreset:
+            {
+                telemetryRing.Record({ telemetry::Type::Param, telemetry::kParamPreset, now, event.value });
+                // Coefficients were computed in the main loop; this only copies them
+                const presets::Preset* preset = presetBank.Get(static_cast<size_t>(event.value));
+                if(preset != nullptr)
+                {
+                    ts.recallCoefficients(preset->coeffs);
+                    preGainSmoother.setTarget(preset->params.preGain);
+                    postGainSmoother.setTarget(preset->params.postGain);
+                }
+                break;
+            }
         }
-        else
+    }
+
+    // Work through the interleaved buffer in chunks of at most kMaxBlockSize frames
+    for (size_t start = 0; start < size; start += 2 * kMaxBlockSize)
+    {
+        const size_t end    = (start + 2 * kMaxBlockSize < size) ? start + 2 * kMaxBlockSize : size;
+        const size_t frames = (end - start) / 2;
+
+        for (size_t n = 0; n < frames; ++n)
+            dryBuf[n] = in[start + 2 * n + 1];
+
+        // The DSP only runs while engaged, fading or kept warm
+        if(bypass.wetNeeded())
         {
-            float x = in[i+1];              // Bypass - just pass input to output
-            out[i + 1] = x;
-            ui.LedWrite(0, on);             // Don't light LED when bypassed
+            if(bypass.consumeResetRequest())
+                ts.reset();                                    // Clear stale state before fading back in
+
+            for (size_t n = 0; n < frames; ++n)
+                wetBuf[n] = dryBuf[n] * preGainSmoother.getNext();   // Apply pre-gain to the input signal
+
+            ts.processBlock(wetBuf, wetBuf, frames);                 // Process the audio signal through the Tube Screamer
+
+            if(!ts.hasFiniteState())
+            {
+                // A NaN or Inf would stay in the WDF states for good: restart from rest, mute this chunk
+                ts.reset();
+                for (size_t n = 0; n < frames; ++n)
+                    wetBuf[n] = 0.0f;
+                telemetryRing.Record({ telemetry::Type::NonFinite, 0, now, 0.0f });
+            }
+
+            for (size_t n = 0; n < frames; ++n)
+                wetBuf[n] *= postGainSmoother.getNext();             // Apply post-gain to the output signal
         }
         /* Pre and Post-Gain is only applied when the effect is on as Post-Gain is effectively the Volume*/
+
+        bypass.process(dryBuf, wetBuf, frames);                // Crossfade between dry and processed
+
+        for (size_t n = 0; n < frames; ++n)
+        {
+            out[start + 2 * n + 1] = wetBuf[n];
+            clips += (wetBuf[n] >= 1.0f || wetBuf[n] <= -1.0f) ? 1 : 0;
+        }
+    }
+
+    loadMeter.OnBlockEnd(size / 2); // frames; the budget follows the size actually running
+
+    // Telemetry after the measured span: a few stores, only when something happened
+    if(clips > 0)
+        telemetryRing.Record({ telemetry::Type::Clip, clips, now, 0.0f });
+
+    const float load = loadMeter.LastLoad();
+    if(load > 1.0f)
+        telemetryRing.Record({ telemetry::Type::Overrun, 0, now, load });
+    telemetryPeakLoad = load > telemetryPeakLoad ? load : telemetryPeakLoad;
+    if(now - telemetryLoadStartMs >= kTelemetryLoadMs)
+    {
+        telemetryRing.Record({ telemetry::Type::Load, 0, now, telemetryPeakLoad });
+        telemetryLoadStartMs = now;
+        telemetryPeakLoad    = 0.0f;
     }
 }
 
-int main(void)
+/** Restarts audio with the given block size, the load meter budgeted for it. */
+void RestartAudio(size_t blockSize)
+{
+    hw.StopAudio();
+    hw.SetAudioBlockSize(blockSize);
+    loadMeter.Init(hw.AudioSampleRate(), blockSize);
+    hw.StartAudio(AudioCallback);
+}
+
+/** Restarts audio with the given block size and returns the peak callback load measured there. */
+float MeasureCallbackLoad(size_t blockSize)
+{
+    RestartAudio(blockSize);
+
+    System::Delay(kCalibrationSettleMs);
+    loadMeter.Reset();
+    System::Delay(kCalibrationMeasureMs);
+
+    return loadMeter.Read().max;
+}
+
+/** Sweeps block sizes 1..64, logs the loads over USB serial and returns the selected size. */
+size_t CalibrateBlockSize()
+{
+    tuning::BlockSizeTuner<> tuner(kCalibrationTargetLoad);
+    const size_t blockSize = tuner.Run(MeasureCallbackLoad);
+
+    for (size_t i = 0; i < tuner.NumCandidates(); ++i)
+        hw.PrintLine("block %3u: max load " FLT_FMT3,
+                     static_cast<unsigned>(tuner.Candidate(i)), FLT_VAR3(tuner.Load(i)));
+    hw.PrintLine("selected block size %u (target " FLT_FMT3 ")",
+                 static_cast<unsigned>(blockSize), FLT_VAR3(tuner.TargetLoad()));
+
+    return blockSize;
+}
+
+/** Main loop: prints what the audio callback recorded since the last pass, one line per event. */
+void DrainTelemetry()
+{
+    telemetryRing.Drain([](const telemetry::Event& e) {
+        char line[80];
+        telemetry::Format(e, line, sizeof(line));
+        hw.PrintLine("%s", line);
+    });
+}
+
+#if TS_PROFILE_STAGES
+constexpr uint32_t kProfileReportMs = 5000;
+
+/** Per-stage timings since boot (cycles per sample; a snapshot, the callback keeps adding). */
+void PrintStageProfile()
+{
+    for (size_t s = 0; s < profile::kNumStages; ++s)
+    {
+        const profile::Histogram& h = profile::histograms[s];
+        hw.PrintLine("%-10s mean " FLT_FMT3 "  p50 %u  p99 %u  max %u",
+                     profile::StageName(static_cast<profile::Stage>(s)), FLT_VAR3(static_cast<float>(h.Mean())),
+                     static_cast<unsigned>(h.Percentile(0.5)), static_cast<unsigned>(h.Percentile(0.99)),
+                     static_cast<unsigned>(h.Max()));
+    }
+    hw.PrintLine("(%s, %u per scope)", profile::Clock::Unit(), static_cast<unsigned>(profile::ScopeOverhead()));
+}
+#endif
+
+// Main loop timers
+uint32_t lastControlMs = 0;
+uint32_t lastBlinkMs   = 0;
+uint32_t lastLoadMs    = 0;
+uint32_t lastProfileMs = 0;
+bool     aliveLed      = false;
+
+/** Brings up the hardware, the DSP and the controls and starts audio. */
+void Setup()
 {
     hw.Init();
-    hw.SetAudioBlockSize(4);
+    denormals::EnableFlushToZero();
+    hw.SetAudioBlockSize(kAudioBlockSize);
     sampleRate = hw.AudioSampleRate();
     ts.prepare(sampleRate);
+    bypass.prepare(sampleRate);
 
     ts.setGain( 10.0f );
-    ts.setTone( 10000.0f, 0.22e-6f );
+    ts.setTone( 10000.0f, kToneCapacitor );
 
-    const float ctrl_hz = hw.AudioSampleRate() / static_cast<float>(hw.AudioBlockSize());
+    // Presets saved on a previous run, or the power-up settings in every slot
+    if(!presetBank.Load(presetStorage, ts, sampleRate))
+        InitDefaultPresets();
+
+    preGainSmoother.prepare(sampleRate, kGainRampMs);
+    postGainSmoother.prepare(sampleRate, kGainRampMs);
+    preGainSmoother.setCurrentAndTarget(1.0f);
+    postGainSmoother.setCurrentAndTarget(1.0f);
 
     // Define pins
     const Pin pot_pins[kNPots]          = { A1, A2, A3, A4, A5, A6 };
@@ -86,18 +412,81 @@ int main(void)
     const Pin foot_pins[kNFoots]        = { D25, D26 };
     const Pin led_pins[]                = { A7, A8 };
 
-    ui.Init(hw, pot_pins, toggle_pins, foot_pins, led_pins, ctrl_hz);
-    
+    ui.Init(hw, pot_pins, toggle_pins, foot_pins, led_pins, kControlRateHz,
+            false, false, false, 0.002f, kPotRateHz, kSwitchRateHz);
+
+    // Pot responses, tabulated once so the control loop never calls std::pow
+    ui.SetPotTaper(0, controls::Taper::Linear, 0.0f, 500000.0f);  // Map pot 0 to gain range
+    ui.SetPotTaper(2, controls::Taper::Log, 1000.0f, 20000.0f);   // Map pot 2 to tone resistor range
+    ui.SetPotTaper(3, controls::Taper::Linear, 0.0f, 1.0f);       // Map pot 3 to pre-gain range
+    ui.SetPotTaper(5, controls::Taper::Linear, 0.0f, 2.0f);       // Map pot 5 to post-gain range
+
+    loadMeter.Init(hw.AudioSampleRate(), hw.AudioBlockSize());
+
     hw.StartAudio(AudioCallback);
 
-    while (1){
+#if TS_CALIBRATE_BLOCK_SIZE
+    hw.StartLog(true); // wait for the serial monitor before sweeping
+    MeasureCallbackLoad(CalibrateBlockSize()); // restart with the selected size and keep running
+#else
+    hw.StartLog(false); // telemetry (and the stage profile) go out over USB serial
+#endif
+
+    lastControlMs = System::GetNow();
+    lastBlinkMs   = lastControlMs;
+    lastLoadMs    = lastControlMs;
+    lastProfileMs = lastControlMs;
+}
+
+/** One pass of the main loop; the audio callback runs on its own interrupt. */
+void Loop()
+{
+    const uint32_t now = System::GetNow();
+
+    // Poll controls and publish a new parameter snapshot at kControlRateHz
+    if(now - lastControlMs >= kControlPeriodMs)
+    {
+        lastControlMs += kControlPeriodMs;
+        UpdateControls();
+    }
 
-        // Toggle DaisySeed LED on/off every second to show aliveness
-        hw.SetLed(true);
-        HAL_Delay(500);
-        hw.SetLed(false);
-        HAL_Delay(500);
+    // Toggle DaisySeed LED on/off every second to show aliveness
+    if(now - lastBlinkMs >= kAliveBlinkMs)
+    {
+        lastBlinkMs += kAliveBlinkMs;
+        aliveLed = !aliveLed;
+        hw.SetLed(aliveLed);
+    }
 
-        hw.DelayMs(1); // Optional: limit control polling rate
+    // Pick up the callback's load statistics (dspLoad) for anything in the main loop to use
+    if(now - lastLoadMs >= kLoadPollMs)
+    {
+        lastLoadMs += kLoadPollMs;
+        dspLoad = loadMeter.Read();
+#if TS_OVERLOAD_LED
+        ui.LedWrite(1, dspLoad.peak >= kOverloadLoad && (now / kOverloadBlinkMs) % 2 == 0);
+#endif
     }
+
+#ifndef TS_HOST_SIM
+    DrainTelemetry(); // the host simulator drains the ring on a background thread instead
+#endif
+
+#if TS_PROFILE_STAGES
+    if(now - lastProfileMs >= kProfileReportMs)
+    {
+        lastProfileMs += kProfileReportMs;
+        PrintStageProfile();
+    }
+#endif
+}
+
+// The host simulator (host/sim) drives Setup() and Loop() itself
+#ifndef TS_HOST_SIM
+int main(void)
+{
+    Setup();
+    while (1)
+        Loop();
 }
+#endif